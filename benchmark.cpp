@@ -0,0 +1,332 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "geo_headers/geometric_basics.h"
+#include "geo_headers/command_line.h"
+#include "geo_headers/thread_pool.h"
+#include "geo_headers/point_reader.h"
+#include "geo_headers/point_location.h"
+#include "geo_headers/locator_factory.h"
+#include "geo_headers/convex_hull.h"
+#include "geo_headers/output_buffer.h"
+#include "geo_headers/workload_generator.h"
+
+typedef long long ll;
+
+using namespace std;
+
+/**
+ * @brief One measured case: an algorithm on a workload with a number of threads.
+ */
+struct BenchmarkResult {
+  string suite;
+  string algorithm;
+  string polygon; /**< The polygon kind, empty for the suites without polygons. */
+  string distribution;
+  size_t polygonSize;
+  size_t pointsCount;
+  int threads;
+  double buildMs; /**< The time to prepare the locator, once. */
+  double minMs; /**< The fastest of the repeated runs. */
+  double medianMs;
+  long peakMemoryKb; /**< The peak resident memory during the case, or of the whole process where it cannot be reset. */
+  bool agrees; /**< True if the answers match the first algorithm run on the same workload. */
+};
+
+/**
+ * @brief Splits a comma separated option value.
+ */
+vector<string> splitList(const string& list) {
+  vector<string> items;
+  stringstream stream(list);
+  string item;
+  while (getline(stream, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  return items;
+}
+
+vector<ll> splitIntegers(const string& list) {
+  vector<ll> values;
+  for (auto& item : splitList(list))
+    values.push_back(atoll(item.c_str()));
+  return values;
+}
+
+/**
+ * @brief Resets the peak resident memory of the process, so that the next reading covers only what follows.
+ * @return False if the kernel does not support it.
+ */
+bool resetPeakMemory() {
+  ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+  clearRefs.close();
+  return !clearRefs.fail();
+}
+
+/**
+ * @return The peak resident memory of the process in kilobytes, 0 if unknown.
+ */
+long getPeakMemoryKb() {
+  ifstream status("/proc/self/status");
+  string line;
+  while (getline(status, line))
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      return atol(line.c_str() + 6);
+  return 0;
+}
+
+/**
+ * @brief Runs a body several times and times every run, leaving the preparation of each run out.
+ * @param prepare Called before every run, untimed.
+ * @return The fastest and the median run time in milliseconds.
+ */
+pair<double, double> timeRuns(int repeats, function<void()> prepare, function<void()> body) {
+  vector<double> times;
+  for (int i = 0; i < repeats; i++) {
+    prepare();
+    auto start = chrono::steady_clock::now();
+    body();
+    times.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+  }
+  sort(times.begin(), times.end());
+  return { times.front(), times[times.size() / 2] };
+}
+
+/**
+ * @brief Times every point location algorithm on every workload, for every number of threads.
+ */
+void runLocateSuite(const CommandLine& commandLine, const vector<int>& threadCounts, int repeats, vector<BenchmarkResult>& results) {
+  WorkloadGenerator generator(commandLine.getInt("seed", 1));
+  size_t pointsCount = commandLine.getInt("points", 1000000);
+  for (auto& polygonKind : splitList(commandLine.getString("polygons", "random,convex,star,clustered,spiral")))
+    for (ll size : splitIntegers(commandLine.getString("sizes", "100,1000,10000")))
+      for (auto& distribution : splitList(commandLine.getString("distributions", "uniform,gaussian,circle"))) {
+        Polygon polygon;
+        vector<Point> points;
+        if (!generator.makePolygon(polygonKind, size, polygon) || !generator.makePoints(distribution, pointsCount, BoundingBox::of(polygon), points)) {
+          cout << "Unknown polygon " << polygonKind << " or distribution " << distribution << "!\n";
+          continue;
+        }
+
+        vector<PointPosition> reference;
+        for (int threads : threadCounts) {
+          ThreadPool pool(threads);
+          for (auto& algorithm : splitList(commandLine.getString("algorithms", "slab,grid,prepared,convex,sweep,ray"))) {
+            BenchmarkResult result = { "locate", algorithm, polygonKind, distribution, (size_t)polygon.getSize(), pointsCount, threads, 0, 0, 0, 0, true };
+            vector<PointPosition> positions(pointsCount);
+            resetPeakMemory();
+            bool known = withNamedLocator(algorithm, polygon, pool, 0, &result.buildMs, [&](auto classify) {
+              classify(points.data(), points.size(), positions.data());
+              tie(result.minMs, result.medianMs) = timeRuns(repeats, []() {}, [&]() { classify(points.data(), points.size(), positions.data()); });
+            });
+            if (!known)
+              continue;
+            result.peakMemoryKb = getPeakMemoryKb();
+            if (reference.empty())
+              reference = positions;
+            result.agrees = positions == reference;
+            results.push_back(result);
+          }
+        }
+      }
+}
+
+/**
+ * @brief Times the convex hull algorithms on every point distribution and size, for every number of threads.
+ */
+void runHullSuite(const CommandLine& commandLine, const vector<int>& threadCounts, int repeats, vector<BenchmarkResult>& results) {
+  WorkloadGenerator generator(commandLine.getInt("seed", 1));
+  const ll radius = WorkloadGenerator::RADIUS;
+  BoundingBox box = { -radius, -radius, radius, radius };
+  for (ll size : splitIntegers(commandLine.getString("hull-sizes", "100000,1000000")))
+    for (auto& distribution : splitList(commandLine.getString("distributions", "uniform,gaussian,circle"))) {
+      vector<Point> input, points;
+      if (!generator.makePoints(distribution, size, box, input)) {
+        cout << "Unknown distribution " << distribution << "!\n";
+        continue;
+      }
+
+      vector<Point> reference;
+      for (int threads : threadCounts) {
+        ThreadPool pool(threads);
+        for (auto& algorithm : splitList(commandLine.getString("hull-algorithms", "monotone,parallel,chan"))) {
+          // The points are sorted or reordered by every run, so each run gets a fresh copy
+          ConvexHull hull;
+          function<void()> build;
+          if (algorithm == "monotone")
+            build = [&]() { sort(points.begin(), points.end()); hull.build(points.data(), points.size()); };
+          else if (algorithm == "parallel")
+            build = [&]() { hull.buildParallel(points.data(), points.size(), pool); };
+          else if (algorithm == "chan")
+            build = [&]() { hull.buildChan(points.data(), points.size(), pool, ConvexHull::sampleHullSize(points.data(), points.size()) * 8); };
+          else {
+            cout << "Unknown hull algorithm " << algorithm << "!\n";
+            continue;
+          }
+
+          BenchmarkResult result = { "hull", algorithm, "", distribution, 0, (size_t)size, threads, 0, 0, 0, 0, true };
+          resetPeakMemory();
+          tie(result.minMs, result.medianMs) = timeRuns(repeats, [&]() { points = input; hull = ConvexHull(); }, build);
+          result.peakMemoryKb = getPeakMemoryKb();
+          vector<Point> vertices = hull.getLower();
+          vertices.insert(vertices.end(), hull.getUpper().begin(), hull.getUpper().end());
+          if (reference.empty())
+            reference = vertices;
+          result.agrees = vertices == reference;
+          results.push_back(result);
+        }
+      }
+    }
+}
+
+/**
+ * @brief Times the text parsers on a generated file: the parallel in-memory reader and the chunked stream reader.
+ */
+void runParseSuite(const CommandLine& commandLine, const vector<int>& threadCounts, int repeats, vector<BenchmarkResult>& results) {
+  WorkloadGenerator generator(commandLine.getInt("seed", 1));
+  const ll radius = WorkloadGenerator::RADIUS;
+  BoundingBox box = { -radius, -radius, radius, radius };
+  for (ll size : splitIntegers(commandLine.getString("parse-sizes", "100000,1000000"))) {
+    vector<Point> points;
+    generator.makePoints("uniform", size, box, points);
+    char path[] = "/tmp/benchmark_points_XXXXXX";
+    int descriptor = mkstemp(path);
+    if (descriptor < 0) {
+      cout << "Could not create a temporary file!\n";
+      return;
+    }
+    close(descriptor);
+    {
+      FileWriter output(path);
+      OutputBuffer text;
+      for (auto point : points) {
+        text.appendInteger(point.getX());
+        text.append(' ');
+        text.appendInteger(point.getY());
+        text.append('\n');
+      }
+      output.write(text);
+    }
+
+    for (int threads : threadCounts) {
+      ThreadPool pool(threads);
+      BenchmarkResult result = { "parse", "text", "", "uniform", 0, (size_t)size, threads, 0, 0, 0, 0, true };
+      PointArray parsed;
+      resetPeakMemory();
+      tie(result.minMs, result.medianMs) = timeRuns(repeats, []() {}, [&]() {
+        MappedFile input(path);
+        result.agrees = input.isOpen() && PointReader::readPoints(input, parsed, &pool) && parsed.size() == points.size();
+      });
+      result.peakMemoryKb = getPeakMemoryKb();
+      results.push_back(result);
+    }
+
+    BenchmarkResult result = { "parse", "stream", "", "uniform", 0, (size_t)size, 1, 0, 0, 0, 0, true };
+    resetPeakMemory();
+    tie(result.minMs, result.medianMs) = timeRuns(repeats, []() {}, [&]() {
+      PointStream input(path);
+      vector<Point> chunk;
+      size_t count = 0;
+      while (input.readChunk(chunk, 1 << 16))
+        count += chunk.size();
+      result.agrees = !input.hasFailed() && count == points.size();
+    });
+    result.peakMemoryKb = getPeakMemoryKb();
+    results.push_back(result);
+    unlink(path);
+  }
+}
+
+/**
+ * @brief Writes the results as CSV, one line per case, or as a JSON array of objects with the same fields.
+ */
+void writeResults(ostream& out, const vector<BenchmarkResult>& results, bool json) {
+  const char* fields[] = { "suite", "algorithm", "polygon", "distribution", "polygon_size", "points", "threads", "build_ms",
+                           "min_ms", "median_ms", "queries_per_second", "ns_per_query", "peak_rss_kb", "agrees" };
+  if (!json) {
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+      out << (i ? "," : "") << fields[i];
+    out << "\n";
+  } else {
+    out << "[\n";
+  }
+  for (size_t r = 0; r < results.size(); r++) {
+    const BenchmarkResult& result = results[r];
+    double seconds = result.medianMs / 1000;
+    ostringstream values[14];
+    values[0] << result.suite;
+    values[1] << result.algorithm;
+    values[2] << result.polygon;
+    values[3] << result.distribution;
+    values[4] << result.polygonSize;
+    values[5] << result.pointsCount;
+    values[6] << result.threads;
+    values[7] << result.buildMs;
+    values[8] << result.minMs;
+    values[9] << result.medianMs;
+    values[10] << (seconds > 0 ? (ll)(result.pointsCount / seconds) : 0);
+    values[11] << (result.pointsCount > 0 ? result.medianMs * 1e6 / result.pointsCount : 0);
+    values[12] << result.peakMemoryKb;
+    values[13] << (result.agrees ? "true" : "false");
+    if (!json) {
+      for (int i = 0; i < 14; i++)
+        out << (i ? "," : "") << values[i].str();
+      out << "\n";
+      continue;
+    }
+    // The first four fields are strings, the others numbers or booleans
+    out << "  {";
+    for (int i = 0; i < 14; i++) {
+      out << (i ? ", " : "") << "\"" << fields[i] << "\": ";
+      if (i < 4)
+        out << "\"" << values[i].str() << "\"";
+      else
+        out << values[i].str();
+    }
+    out << (r + 1 < results.size() ? "},\n" : "}\n");
+  }
+  if (json)
+    out << "]\n";
+}
+
+int main(int argc, char* argv[]) {
+  CommandLine commandLine(argc, argv);
+  vector<int> threadCounts;
+  for (ll threads : splitIntegers(commandLine.getString("threads", to_string(thread::hardware_concurrency()))))
+    threadCounts.push_back(max(threads, 1LL));
+  int repeats = max(commandLine.getInt("repeat", 3), 1LL);
+  string format = commandLine.getString("format", "csv");
+  if (format != "csv" && format != "json") {
+    cout << "Unknown format " << format << ", use csv or json!\n";
+    return 0;
+  }
+
+  vector<BenchmarkResult> results;
+  for (auto& suite : splitList(commandLine.getString("suite", "locate,hull,parse"))) {
+    if (suite == "locate")
+      runLocateSuite(commandLine, threadCounts, repeats, results);
+    else if (suite == "hull")
+      runHullSuite(commandLine, threadCounts, repeats, results);
+    else if (suite == "parse")
+      runParseSuite(commandLine, threadCounts, repeats, results);
+    else
+      cout << "Unknown suite " << suite << ", use locate, hull or parse!\n";
+  }
+
+  if (commandLine.hasOption("output")) {
+    ofstream fout(commandLine.getString("output", ""));
+    writeResults(fout, results, format == "json");
+  } else {
+    writeResults(cout, results, format == "json");
+  }
+  return 0;
+}
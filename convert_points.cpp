@@ -0,0 +1,51 @@
+#include <iostream>
+#include <vector>
+#include "geo_headers/command_line.h"
+#include "geo_headers/thread_pool.h"
+#include "geo_headers/point_reader.h"
+#include "geo_headers/binary_points.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+  CommandLine commandLine(argc, argv);
+  if (commandLine.getPositionalCount() < 2) {
+    cout << "Please pass the input and output files name!\n";
+    return 0;
+  }
+
+  ThreadPool pool(commandLine.getInt("threads", 0));
+  MappedFile input(commandLine.getPositional(0));
+  if (!input.isOpen()) {
+    cout << "Invalid input file!\n";
+    return 0;
+  }
+
+  // The ray casting format starts with a polygon, the convex hull one is only points
+  vector<Point> polygonPoints, points;
+  string format = commandLine.getString("format", "hull");
+  if (format == "ray") {
+    Polygon polygon;
+    if (!PointReader::readPolygonAndPoints(input, polygon, points, &pool)) {
+      cout << "Invalid input file!\n";
+      return 0;
+    }
+    for (int i = 0; i < polygon.getSize(); i++)
+      polygonPoints.push_back(polygon.getPoint(i));
+  } else if (format == "hull") {
+    if (!PointReader::readPoints(input, points, &pool)) {
+      cout << "Invalid input file!\n";
+      return 0;
+    }
+  } else {
+    cout << "Unknown format " << format << "!\n";
+    return 0;
+  }
+
+  if (!BinaryPointsFile::write(commandLine.getPositional(1), polygonPoints, points)) {
+    cout << "Could not write the output file!\n";
+    return 0;
+  }
+  cout << "Wrote " << polygonPoints.size() << " polygon points and " << points.size() << " points\n";
+  return 0;
+}
@@ -1,93 +1,286 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <algorithm>
-#include <map>
+#include "geo_headers/geometric_basics.h"
+#include "geo_headers/command_line.h"
+#include "geo_headers/thread_pool.h"
+#include "geo_headers/point_reader.h"
+#include "geo_headers/binary_points.h"
+#include "geo_headers/convex_hull.h"
+#include "geo_headers/dynamic_hull.h"
+#include "geo_headers/output_buffer.h"
+#ifndef GEO_HEADLESS
 #include "geo_headers/renderer.h"
+#include "geo_headers/density_map.h"
+#endif
 
 typedef long long ll;
 
 using namespace std;
 
-int main(int argc, char* argv[]) {
-  if (argc < 3) {
-    cout << "Please pass the input and output files name!\n";
-    return 0;
+#ifndef GEO_HEADLESS
+/**
+ * @brief Shows the points and the hull chains until the window is closed, redrawing only when needed.
+ * @param density If true, the points are aggregated per pixel into a density map that can be panned and zoomed.
+ */
+template <class T>
+void visualize(const vector<BasicPoint<T>>& points, const ConvexHull& convexHull, ThreadPool& pool, bool density) {
+  Renderer renderer(800, 800, "Convex Hull");
+  if (!renderer.isOpen()) {
+    cout << "Could not open a window, use --headless on machines without a display!\n";
+    return;
   }
+  Polygon convexHullInferior(convexHull.getLower());
+  Polygon convexHullSuperior(convexHull.getUpper());
+  renderer.fit(points.data(), points.size());
 
-  ifstream fin(argv[1]);
-  ofstream fout(argv[2]);
+  if (density) {
+    DensityMap densityMap(800, 800, { {22, 14, 237} });
+    densityMap.setPoints(points.data(), points.size(), [](size_t) { return 0; }, pool);
+    densityMap.setView(0, 0, 1 / renderer.getScale());
+    ViewChange change;
+    do {
+      densityMap.pan(change.panX, change.panY);
+      if (change.zoom != 1)
+        densityMap.zoom(change.zoom, change.zoomX, change.zoomY);
+      densityMap.update(pool);
+      renderer.setView(densityMap.getCenterX(), densityMap.getCenterY(), 1 / densityMap.getUnitsPerPixel());
+      renderer.drawPixels(densityMap.getPixels());
 
-  vector<Point> points;
-  Point p;
-  
-  while (fin>>p) {
-    points.push_back(p);
+      //draw convex hull polygon 
+      renderer.drawPolygon(convexHullInferior, 192, 17, 250, false);
+      renderer.drawPolygon(convexHullSuperior, 49, 8, 138, false);
+      for (int i = 0; i < convexHullInferior.getSize(); i++)
+        renderer.drawPoint(convexHullInferior.getPoint(i), 150, 0, 0);
+      for (int i = 0; i < convexHullSuperior.getSize(); i++)
+        renderer.drawPoint(convexHullSuperior.getPoint(i), 150, 0, 0);
+      renderer.update();
+    } while (renderer.waitForRedraw(&change));
+    return;
   }
-  sort(points.begin(), points.end());
 
-  
+  // Transform every point once, grouped by color, instead of drawing them one by one every frame
+  PointBatch allPoints(22, 14, 237);
+  for (auto p : points)
+    renderer.addToBatch(allPoints, Point(p));
+  PointBatch hullPoints(150, 0, 0);
+  for (int i = 0; i < convexHullInferior.getSize(); i++)
+    renderer.addToBatch(hullPoints, convexHullInferior.getPoint(i));
+  for (int i = 0; i < convexHullSuperior.getSize(); i++)
+    renderer.addToBatch(hullPoints, convexHullSuperior.getPoint(i));
+
+  do {
+    renderer.drawCached([&]() {
+      renderer.clear();
+      renderer.drawAxis();
+      renderer.drawBatch(allPoints);
+
+      //draw convex hull polygon 
+      renderer.drawPolygon(convexHullInferior, 192, 17, 250, false);
+      renderer.drawPolygon(convexHullSuperior, 49, 8, 138, false);
+      renderer.drawBatch(hullPoints);
+    });
+    renderer.update();
+  } while (renderer.waitForRedraw());
+}
+#endif
+
+/**
+ * @brief The sample hull size under which the automatic algorithm picks Chan's algorithm.
+ */
+const size_t SMALL_HULL_SIZE = 32;
+
+/**
+ * @brief Builds the hull of points loaded in memory, with their own coordinate type.
+ * @param points The points, reordered by the algorithms.
+ * @param convexHull Receives the hull.
+ * @return False if the algorithm is unknown.
+ */
+template <class T>
+bool buildHullOf(const CommandLine& commandLine, vector<BasicPoint<T>>& points, ConvexHull& convexHull, ThreadPool& pool) {
+  // The hull is built on the prefilter survivors, the points themselves are kept for the visualization
+  vector<BasicPoint<T>> survivors;
+  vector<BasicPoint<T>>* hullPoints = &points;
+  if (commandLine.hasOption("prefilter")) {
+    size_t discarded = BasicConvexHull<T>::prefilter(points.data(), points.size(), survivors, pool);
+    cout << "Prefilter discarded " << discarded << " of " << points.size() << " points\n";
+    hullPoints = &survivors;
+  }
 
-  Polygon convexHullInferior;
-  convexHullInferior.addPoint(points[0]);
-  convexHullInferior.addPoint(points[1]);
-  for (int i = 2; i < points.size(); i++) {
-    Point p1 = convexHullInferior.getPoint(convexHullInferior.getSize() - 2);
-    Point p2 = convexHullInferior.getPoint(convexHullInferior.getSize() - 1);
-    Point p3 = points[i];
-    while (orientationTest(p1,p2,p3) <= 0 && convexHullInferior.getSize() >= 2) {
-      convexHullInferior.removeLastPoint();
-      p1 = convexHullInferior.getPoint(convexHullInferior.getSize() - 2);
-      p2 = convexHullInferior.getPoint(convexHullInferior.getSize() - 1);  
+  string algorithm = commandLine.getString("algorithm", "auto");
+  size_t sampleHullSize = 0;
+  if (algorithm == "auto" || algorithm == "chan")
+    sampleHullSize = BasicConvexHull<T>::sampleHullSize(hullPoints->data(), hullPoints->size());
+  if (algorithm == "auto") {
+    // Chan's algorithm only pays off when the hull is small compared to the points
+    algorithm = sampleHullSize <= SMALL_HULL_SIZE ? "chan" : "parallel";
+  }
+  BasicConvexHull<T> hull;
+  if (algorithm == "monotone") {
+    {
+      GEO_PHASE("sort");
+      sort(hullPoints->begin(), hullPoints->end());
     }
-    convexHullInferior.addPoint(p3);
-  }
-
-  Polygon convexHullSuperior;
-  convexHullSuperior.addPoint(points[points.size() - 1]);
-  convexHullSuperior.addPoint(points[points.size() - 2]);
-  for (int i = points.size() - 3; i >= 0; i--) {
-    Point p1 = convexHullSuperior.getPoint(convexHullSuperior.getSize() - 2);
-    Point p2 = convexHullSuperior.getPoint(convexHullSuperior.getSize() - 1);
-    Point p3 = points[i];
-    while (orientationTest(p1,p2,p3) <= 0 && convexHullSuperior.getSize() >= 2) {
-      convexHullSuperior.removeLastPoint();
-      p1 = convexHullSuperior.getPoint(convexHullSuperior.getSize() - 2);
-      p2 = convexHullSuperior.getPoint(convexHullSuperior.getSize() - 1);  
+    GEO_PHASE("hull");
+    hull.build(hullPoints->data(), hullPoints->size());
+  } else if (algorithm == "parallel") {
+    hull.buildParallel(hullPoints->data(), hullPoints->size(), pool);
+  } else if (algorithm == "chan") {
+    // The sample hull misses the vertices between its own, the first guess leaves room for them
+    hull.buildChan(hullPoints->data(), hullPoints->size(), pool, sampleHullSize * 8);
+  } else {
+    cout << "Unknown algorithm, use auto, monotone, parallel or chan!\n";
+    return false;
+  }
+
+  // The hull of the widened vertices has the same chains
+  vector<Point> vertices;
+  for (auto point : hull.getLower())
+    vertices.push_back(Point(point));
+  for (auto point : hull.getUpper())
+    vertices.push_back(Point(point));
+  sort(vertices.begin(), vertices.end());
+  convexHull.build(vertices.data(), vertices.size());
+  return true;
+}
+
+/**
+ * @brief Builds the hull of the whole input in memory.
+ * @param points Receives the input points, with the narrowest coordinate type that holds them.
+ * @return False if the input could not be read.
+ */
+bool buildHull(const CommandLine& commandLine, PointArray& points, ConvexHull& convexHull, ThreadPool& pool) {
+  MappedFile input(commandLine.getPositional(0));
+  if (input.isOpen() && BinaryPointsFile::isBinary(input)) {
+    // The points get sorted, so they are copied out of the mapping
+    BinaryPointsFile binaryInput(input);
+    if (!binaryInput.isValid()) {
+      cout << "Invalid input file!\n";
+      return false;
     }
-    convexHullSuperior.addPoint(p3);
+    binaryInput.copyPoints(points, &pool);
+  } else if (!input.isOpen() || !PointReader::readPoints(input, points, &pool)) {
+    cout << "Invalid input file!\n";
+    return false;
   }
-  
-  for (int i = 0; i < convexHullInferior.getSize(); i++)
-    fout << convexHullInferior.getPoint(i) << endl;
-  for (int i = 0; i < convexHullSuperior.getSize(); i++)
-    fout << convexHullSuperior.getPoint(i) << endl;
+  return points.visit([&](auto& loaded) { return buildHullOf(commandLine, loaded, convexHull, pool); });
+}
 
-  Renderer renderer(800, 800, "Convex Hull");
-  bool running = true;
-  while (running) { 
-    if (renderer.shouldQuit())
-      running = false;
-    
-    renderer.clear();
-    renderer.drawAxis();
-
-    // draw all points
-    for (auto p : points)
-      renderer.drawPoint(p);
-
-    //draw convex hull polygon 
-    renderer.drawPolygon(convexHullInferior, 192, 17, 250, false);
-    for (int i = 0; i < convexHullInferior.getSize(); i++)
-      renderer.drawPoint(convexHullInferior.getPoint(i), 150, 0, 0);
-
-    renderer.drawPolygon(convexHullSuperior, 49, 8, 138, false);
-    for (int i = 0; i < convexHullSuperior.getSize(); i++)
-      renderer.drawPoint(convexHullSuperior.getPoint(i), 150, 0, 0);
+/**
+ * @brief Builds the hull of a text input chunk by chunk, keeping only the running hull between chunks.
+ * @return False if the input could not be read.
+ */
+bool buildStreamHull(const CommandLine& commandLine, ConvexHull& convexHull, ThreadPool& pool) {
+  PointStream input(commandLine.getPositional(0));
+  if (!input.isOpen()) {
+    cout << "Invalid input file!\n";
+    return false;
+  }
 
-    renderer.update();
+  size_t chunkSize = max(commandLine.getInt("chunk", 1 << 22), 1LL);
+  size_t pointsCount = 0, discarded = 0;
+  vector<Point> chunk, survivors;
+  while (input.readChunk(chunk, chunkSize)) {
+    pointsCount += chunk.size();
+    if (commandLine.hasOption("prefilter")) {
+      discarded += ConvexHull::prefilter(chunk.data(), chunk.size(), survivors, pool);
+      chunk.swap(survivors);
+    }
+    convexHull.extend(chunk.data(), chunk.size(), pool);
   }
-  fin.close();
-  fout.close();
-  
-}
\ No newline at end of file
+  if (input.hasFailed()) {
+    cout << "Invalid input file!\n";
+    return false;
+  }
+  if (commandLine.hasOption("prefilter"))
+    cout << "Prefilter discarded " << discarded << " of " << pointsCount << " points\n";
+  return true;
+}
+
+/**
+ * @brief Inserts the points of a text input one by one in a dynamic hull, as they are read.
+ * @return False if the input could not be read.
+ */
+bool buildDynamicHull(const CommandLine& commandLine, ConvexHull& convexHull) {
+  PointStream input(commandLine.getPositional(0));
+  if (!input.isOpen()) {
+    cout << "Invalid input file!\n";
+    return false;
+  }
+
+  DynamicHull dynamicHull;
+  size_t pointsCount = 0, changes = 0;
+  vector<Point> chunk;
+  while (input.readChunk(chunk, 1))
+    for (auto point : chunk) {
+      pointsCount++;
+      if (dynamicHull.insert(point))
+        changes++;
+    }
+  if (input.hasFailed()) {
+    cout << "Invalid input file!\n";
+    return false;
+  }
+  cout << changes << " of " << pointsCount << " points changed the hull\n";
+
+  // Rebuilding from the current vertices gives the same chains, for the output and the visualization
+  vector<Point> vertices, upper;
+  dynamicHull.getLower(vertices);
+  dynamicHull.getUpper(upper);
+  vertices.insert(vertices.end(), upper.begin(), upper.end());
+  sort(vertices.begin(), vertices.end());
+  convexHull.build(vertices.data(), vertices.size());
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  CommandLine commandLine(argc, argv);
+  setInstrumentationReport(commandLine.getString("instrument-json", ""));
+  if (commandLine.getPositionalCount() < 2) {
+    cout << "Please pass the input and output files name!\n";
+    return 0;
+  }
+
+  ThreadPool pool(commandLine.getInt("threads", 0));
+
+  PointArray points;
+  ConvexHull convexHull;
+  if (commandLine.hasOption("dynamic")) {
+    if (!buildDynamicHull(commandLine, convexHull))
+      return 0;
+    vector<Point>& hullPoints = points.reset<ll>(0);
+    hullPoints = convexHull.getLower();
+    hullPoints.insert(hullPoints.end(), convexHull.getUpper().begin(), convexHull.getUpper().end());
+  } else if (commandLine.hasOption("stream")) {
+    if (!buildStreamHull(commandLine, convexHull, pool))
+      return 0;
+    // Only the hull is left to show
+    vector<Point>& hullPoints = points.reset<ll>(0);
+    hullPoints = convexHull.getLower();
+    hullPoints.insert(hullPoints.end(), convexHull.getUpper().begin(), convexHull.getUpper().end());
+  } else if (!buildHull(commandLine, points, convexHull, pool)) {
+    return 0;
+  }
+  FileWriter output(commandLine.getPositional(1));
+  if (!output.isOpen()) {
+    cout << "Could not create the output file!\n";
+    return 0;
+  }
+  OutputBuffer text;
+  GEO_PHASE("output");
+  for (auto point : convexHull.getLower()) {
+    text.appendPoint(point);
+    text.append('\n');
+  }
+  for (auto point : convexHull.getUpper()) {
+    text.appendPoint(point);
+    text.append('\n');
+  }
+  output.write(text);
+
+#ifndef GEO_HEADLESS
+  if (!commandLine.hasOption("headless"))
+    points.visit([&](auto& shown) { visualize(shown, convexHull, pool, commandLine.hasOption("density") || shown.size() > DensityMap::POINTS_THRESHOLD); });
+#endif
+  return 0;
+}
@@ -0,0 +1,243 @@
+#ifndef BINARY_POINTS_H
+#define BINARY_POINTS_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include "geometric_basics.h"
+#include "point_reader.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+static_assert(sizeof(Point) == 2 * sizeof(ll), "Point must be two packed coordinates to be mapped from a file");
+static_assert(sizeof(BasicPoint<int32_t>) == 2 * sizeof(int32_t), "BasicPoint<int32_t> must be two packed coordinates to be mapped from a file");
+
+/**
+ * @brief The header at the start of a binary points file.
+ *
+ * The file holds an optional polygon section and a points section. Each section is an array of (x, y) pairs,
+ * stored as int32 when every coordinate of the file fits, as int64 otherwise, in native byte order,
+ * starting at an offset aligned to 64 bytes.
+ */
+struct BinaryPointsHeader {
+  char magic[4]; /**< Always "GEOP". */
+  uint32_t version; /**< The format version, BinaryPointsFile::VERSION. */
+  uint32_t coordinateBytes; /**< The size of one coordinate: 4 or 8. */
+  uint32_t reserved;
+  uint64_t polygonSize; /**< The number of polygon points, 0 if the file has no polygon. */
+  uint64_t polygonOffset; /**< The offset of the polygon section from the start of the file. */
+  uint64_t pointsCount; /**< The number of points. */
+  uint64_t pointsOffset; /**< The offset of the points section from the start of the file. */
+};
+
+/**
+ * @brief A binary points file, read in place from a memory mapping.
+ */
+class BinaryPointsFile {
+private:
+  const char* data;
+  BinaryPointsHeader header;
+  bool valid;
+
+  ll getCoordinate(uint64_t offset, uint64_t index) const;
+public:
+  static const uint32_t VERSION = 1;
+  static const uint64_t ALIGNMENT = 64;
+
+  /**
+   * @param file The mapped file; it must outlive this object.
+   */
+  BinaryPointsFile(const MappedFile& file);
+
+  /**
+   * @return True if the file starts with the binary points magic, whether it is valid or not.
+   */
+  static bool isBinary(const MappedFile& file);
+
+  /**
+   * @return True if the header is supported and every section lies inside the file.
+   */
+  bool isValid() const { return valid; }
+
+  int getCoordinateBytes() const { return header.coordinateBytes; }
+  uint64_t getPolygonSize() const { return header.polygonSize; }
+  uint64_t getPointsCount() const { return header.pointsCount; }
+
+  /**
+   * @brief Builds the polygon stored in the file.
+   * @param polygon Receives the polygon points.
+   */
+  void readPolygon(Polygon& polygon) const;
+
+  /**
+   * @param index The index of the point.
+   * @return The point at the specified index of the points section.
+   */
+  Point getPoint(uint64_t index) const;
+
+  /**
+   * @tparam T The coordinate type: ll for int64 files, int32_t for int32 files.
+   * @return The points section itself when its coordinates are stored as T, nullptr otherwise.
+   */
+  template <class T = ll>
+  const BasicPoint<T>* getMappedPoints() const;
+
+  /**
+   * @brief Copies the points section, widening int32 coordinates.
+   * @param points Receives the points.
+   * @param pool The threads to run on, or nullptr to copy on the calling thread.
+   */
+  void copyPoints(vector<Point>& points, ThreadPool* pool) const;
+
+  /**
+   * @brief Copies the points section with the coordinate type of the file.
+   * @param points Receives the points.
+   * @param pool The threads to run on, or nullptr to copy on the calling thread.
+   */
+  void copyPoints(PointArray& points, ThreadPool* pool) const;
+
+  /**
+   * @brief Writes a binary points file, with int32 coordinates when they all fit.
+   * @param path The path of the file to create.
+   * @param polygon The polygon points, empty for a file without polygon.
+   * @param points The points.
+   * @return False if the file could not be written.
+   */
+  static bool write(const string& path, const vector<Point>& polygon, const vector<Point>& points);
+};
+
+BinaryPointsFile::BinaryPointsFile(const MappedFile& file) {
+  data = file.getData();
+  valid = false;
+  memset(&header, 0, sizeof(header));
+  if (!isBinary(file) || file.getSize() < sizeof(header))
+    return;
+  memcpy(&header, data, sizeof(header));
+  if (header.version != VERSION || (header.coordinateBytes != 4 && header.coordinateBytes != 8))
+    return;
+
+  // Every section must be aligned and lie inside the file
+  uint64_t pairBytes = 2 * header.coordinateBytes;
+  if (header.polygonOffset % ALIGNMENT != 0 || header.pointsOffset % ALIGNMENT != 0)
+    return;
+  // Compared as counts of pairs after the offset, so that no sum or product can wrap around
+  uint64_t size = file.getSize();
+  if (header.polygonOffset > size || header.polygonSize > (size - header.polygonOffset) / pairBytes)
+    return;
+  if (header.pointsOffset > size || header.pointsCount > (size - header.pointsOffset) / pairBytes)
+    return;
+  valid = true;
+}
+
+bool BinaryPointsFile::isBinary(const MappedFile& file) {
+  return file.getSize() >= 4 && memcmp(file.getData(), "GEOP", 4) == 0;
+}
+
+ll BinaryPointsFile::getCoordinate(uint64_t offset, uint64_t index) const {
+  if (header.coordinateBytes == 4)
+    return ((const int32_t*)(data + offset))[index];
+  return ((const int64_t*)(data + offset))[index];
+}
+
+void BinaryPointsFile::readPolygon(Polygon& polygon) const {
+  for (uint64_t i = 0; i < header.polygonSize; i++) {
+    Point point(getCoordinate(header.polygonOffset, 2 * i), getCoordinate(header.polygonOffset, 2 * i + 1));
+    polygon.addPoint(point);
+  }
+  polygon.checkLastPoint();
+}
+
+Point BinaryPointsFile::getPoint(uint64_t index) const {
+  return Point(getCoordinate(header.pointsOffset, 2 * index), getCoordinate(header.pointsOffset, 2 * index + 1));
+}
+
+template <class T>
+const BasicPoint<T>* BinaryPointsFile::getMappedPoints() const {
+  if (header.coordinateBytes != sizeof(T))
+    return nullptr;
+  return (const BasicPoint<T>*)(data + header.pointsOffset);
+}
+
+void BinaryPointsFile::copyPoints(vector<Point>& points, ThreadPool* pool) const {
+  points.resize(header.pointsCount);
+  auto body = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      points[i] = getPoint(i);
+  };
+  if (pool == nullptr)
+    body(0, points.size());
+  else
+    pool->parallelFor(points.size(), 0, body);
+}
+
+void BinaryPointsFile::copyPoints(PointArray& points, ThreadPool* pool) const {
+  if (header.coordinateBytes == 8) {
+    copyPoints(points.reset<ll>(0), pool);
+    return;
+  }
+  vector<BasicPoint<int32_t>>& narrowPoints = points.reset<int32_t>(header.pointsCount);
+  const BasicPoint<int32_t>* mapped = getMappedPoints<int32_t>();
+  auto body = [&](size_t begin, size_t end) {
+    copy(mapped + begin, mapped + end, narrowPoints.begin() + begin);
+  };
+  if (pool == nullptr)
+    body(0, narrowPoints.size());
+  else
+    pool->parallelFor(narrowPoints.size(), 0, body);
+}
+
+bool BinaryPointsFile::write(const string& path, const vector<Point>& polygon, const vector<Point>& points) {
+  BinaryPointsHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "GEOP", 4);
+  header.version = VERSION;
+
+  header.coordinateBytes = 4;
+  for (const vector<Point>* section : { &polygon, &points })
+    for (const Point& point : *section)
+      if (point.getX() != (int32_t)point.getX() || point.getY() != (int32_t)point.getY())
+        header.coordinateBytes = 8;
+
+  auto align = [](uint64_t offset) { return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; };
+  header.polygonSize = polygon.size();
+  header.polygonOffset = align(sizeof(header));
+  header.pointsCount = points.size();
+  header.pointsOffset = align(header.polygonOffset + polygon.size() * 2 * header.coordinateBytes);
+
+  ofstream out(path, ios::binary);
+  if (!out)
+    return false;
+  out.write((const char*)&header, sizeof(header));
+
+  uint64_t written = sizeof(header);
+  vector<char> buffer;
+  for (const vector<Point>* section : { &polygon, &points }) {
+    uint64_t offset = section == &polygon ? header.polygonOffset : header.pointsOffset;
+    buffer.assign(offset - written, 0);
+    for (const Point& point : *section) {
+      ll coordinates[2] = { point.getX(), point.getY() };
+      for (ll coordinate : coordinates) {
+        if (header.coordinateBytes == 4) {
+          int32_t value = coordinate;
+          buffer.insert(buffer.end(), (const char*)&value, (const char*)&value + 4);
+        } else {
+          int64_t value = coordinate;
+          buffer.insert(buffer.end(), (const char*)&value, (const char*)&value + 8);
+        }
+      }
+      if (buffer.size() >= (1 << 20)) {
+        out.write(buffer.data(), buffer.size());
+        buffer.clear();
+      }
+    }
+    out.write(buffer.data(), buffer.size());
+    written = offset + section->size() * 2 * header.coordinateBytes;
+  }
+  return (bool)out;
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief A fixed capacity queue between exactly one producer thread and one consumer thread, the link between
+ * two stages of a pipeline.
+ *
+ * The slots form a ring indexed by two counters that only their owner writes, so no lock is taken while items
+ * flow: a full queue makes the producer wait and an empty one the consumer, which bounds the memory of the pipeline
+ * and lets the slowest stage set the pace. A waiting thread spins briefly, then sleeps on a condition variable,
+ * so a stalled stage does not take a core from the others.
+ */
+template <class T>
+class BoundedQueue {
+private:
+  vector<T> slots;
+  alignas(64) atomic<size_t> head; /**< The number of items popped, written by the consumer only. */
+  alignas(64) atomic<size_t> tail; /**< The number of items pushed, written by the producer only. */
+  atomic<bool> closed;
+
+  // The sleeping side, woken by the other one after it moves a counter
+  static const int SPIN_COUNT = 64;
+  mutex lock;
+  condition_variable changed;
+  atomic<int> sleepers;
+
+  /**
+   * @brief Returns once a condition on the counters holds, spinning first, then sleeping until a change.
+   */
+  template <class Ready>
+  void waitUntil(Ready ready);
+
+  /**
+   * @brief Wakes the other side if it sleeps; called after every change of the counters.
+   */
+  void notify();
+
+  BoundedQueue(const BoundedQueue&);
+  BoundedQueue& operator=(const BoundedQueue&);
+public:
+  /**
+   * @param capacity The number of items the queue holds at most.
+   */
+  BoundedQueue(size_t capacity);
+
+  /**
+   * @brief Adds an item, waiting while the queue is full. Only called by the producer.
+   */
+  void push(T&& item);
+
+  /**
+   * @brief Tells the consumer that no more items will come. Only called by the producer.
+   */
+  void close();
+
+  /**
+   * @brief Takes the oldest item, waiting while the queue is empty. Only called by the consumer.
+   * @param item Receives the item.
+   * @return False once the queue is closed and every item was taken.
+   */
+  bool pop(T& item);
+};
+
+template <class T>
+BoundedQueue<T>::BoundedQueue(size_t capacity) : slots(max<size_t>(capacity, 1)) {
+  head = 0;
+  tail = 0;
+  closed = false;
+  sleepers = 0;
+}
+
+template <class T>
+template <class Ready>
+void BoundedQueue<T>::waitUntil(Ready ready) {
+  for (int i = 0; i < SPIN_COUNT; i++) {
+    if (ready())
+      return;
+    this_thread::yield();
+  }
+  // The sleeper is counted before the condition is checked again, and the counters are moved before the sleepers
+  // are read, all sequentially consistent: either the check sees the change, or notify() sees the sleeper
+  unique_lock<mutex> guard(lock);
+  sleepers.fetch_add(1);
+  changed.wait(guard, ready);
+  sleepers.fetch_sub(1);
+}
+
+template <class T>
+void BoundedQueue<T>::notify() {
+  if (sleepers.load() == 0)
+    return;
+  // Taking the lock waits for a sleeper between its check and its wait, so the wake-up cannot be missed
+  { lock_guard<mutex> guard(lock); }
+  changed.notify_all();
+}
+
+template <class T>
+void BoundedQueue<T>::push(T&& item) {
+  size_t pushed = tail.load(memory_order_relaxed);
+  waitUntil([&] { return pushed - head.load() < slots.size(); });
+  slots[pushed % slots.size()] = move(item);
+  tail.store(pushed + 1);
+  notify();
+}
+
+template <class T>
+void BoundedQueue<T>::close() {
+  closed.store(true);
+  notify();
+}
+
+template <class T>
+bool BoundedQueue<T>::pop(T& item) {
+  size_t popped = head.load(memory_order_relaxed);
+  waitUntil([&] { return popped != tail.load() || closed.load(); });
+  // The tail is read again after seeing the queue closed, in case the last push came just before the close
+  if (popped == tail.load())
+    return false;
+  item = move(slots[popped % slots.size()]);
+  head.store(popped + 1);
+  notify();
+  return true;
+}
+
+#endif
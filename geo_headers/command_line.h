@@ -0,0 +1,86 @@
+#ifndef COMMAND_LINE_H
+#define COMMAND_LINE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>
+
+using namespace std;
+
+/**
+ * @brief Splits the program arguments into positional arguments and options.
+ *
+ * Options are written as "--name" for flags or "--name=value" for values, in any place on the command line.
+ */
+class CommandLine {
+private:
+  vector<string> positional;
+  map<string, string> options;
+public:
+  CommandLine(int argc, char* argv[]);
+
+  /**
+   * @return The number of positional arguments.
+   */
+  int getPositionalCount() const { return positional.size(); }
+
+  /**
+   * @param index The index of the positional argument, not counting the options.
+   * @return The positional argument.
+   */
+  string getPositional(int index) const { return positional[index]; }
+
+  /**
+   * @param name The option name, without the leading dashes.
+   * @return True if the option was passed, with or without a value.
+   */
+  bool hasOption(const string& name) const { return options.count(name) > 0; }
+
+  /**
+   * @param name The option name, without the leading dashes.
+   * @param defaultValue The value returned when the option was not passed.
+   * @return The value of the option.
+   */
+  string getString(const string& name, const string& defaultValue) const;
+
+  /**
+   * @param name The option name, without the leading dashes.
+   * @param defaultValue The value returned when the option was not passed or is not a number.
+   * @return The value of the option.
+   */
+  long long getInt(const string& name, long long defaultValue) const;
+};
+
+CommandLine::CommandLine(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    string argument = argv[i];
+    if (argument.size() <= 2 || argument.compare(0, 2, "--") != 0) {
+      positional.push_back(argument);
+      continue;
+    }
+    size_t equals = argument.find('=');
+    if (equals == string::npos)
+      options[argument.substr(2)] = "";
+    else
+      options[argument.substr(2, equals - 2)] = argument.substr(equals + 1);
+  }
+}
+
+string CommandLine::getString(const string& name, const string& defaultValue) const {
+  auto it = options.find(name);
+  if (it == options.end() || it->second.empty())
+    return defaultValue;
+  return it->second;
+}
+
+long long CommandLine::getInt(const string& name, long long defaultValue) const {
+  string value = getString(name, "");
+  if (value.empty())
+    return defaultValue;
+  char* end;
+  long long result = strtoll(value.c_str(), &end, 10);
+  return *end == '\0' ? result : defaultValue;
+}
+
+#endif
@@ -0,0 +1,463 @@
+#ifndef CONVEX_HULL_H
+#define CONVEX_HULL_H
+
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <type_traits>
+#include "geometric_basics.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/**
+ * @brief The convex hull of a set of points, as the lower and upper chains of the monotone chain algorithm.
+ *
+ * The lower chain goes from the smallest point (by x, then y) to the largest one, the upper chain goes back.
+ * Collinear points are dropped, so only the strict hull vertices are kept.
+ *
+ * @tparam T The integer coordinate type of the points: int32_t halves the memory and bandwidth of large inputs.
+ */
+template <class T>
+class BasicConvexHull {
+private:
+  static_assert(is_integral<T>::value, "The hull needs exact integer coordinates");
+
+  typedef BasicPoint<T> Point; /**< The points of the hull, with the coordinate type of the hull. */
+
+  vector<Point> lower; /**< The lower chain, from the smallest point to the largest one. */
+  vector<Point> upper; /**< The upper chain, from the largest point back to the smallest one. */
+
+  /**
+   * @brief The size under which a parallel build runs on the calling thread only.
+   */
+  static const size_t PARALLEL_THRESHOLD = 1 << 16;
+
+  /**
+   * @brief Appends the points to a chain, removing the previous points that do not make a left turn.
+   * @param points The sorted points.
+   * @param count The number of points.
+   * @param reversed If true, the points are walked from the last one to the first one.
+   * @param chain Receives the chain.
+   */
+  static void buildChain(const Point* points, size_t count, bool reversed, vector<Point>& chain);
+
+  /**
+   * @brief Appends the points of both chains to a list of candidate hull vertices.
+   */
+  void appendVertices(vector<Point>& vertices) const;
+
+  /**
+   * @brief Finds the next hull vertex after a point in a gift wrapping: the vertex of a convex polygon that leaves
+   * no vertex strictly to the right of the line from the point to it, the farthest one if several are collinear.
+   *
+   * A binary search is tried first; its result is verified against the neighbouring vertices,
+   * and a linear scan is used when it cannot be confirmed.
+   *
+   * @param polygon The vertices of a convex polygon, counterclockwise.
+   * @param size The number of vertices.
+   * @param point The current vertex of the wrapping, on the boundary of or outside the polygon.
+   * @return The index of the vertex, or -1 if every vertex of the polygon is equal to the point.
+   */
+  static int findTangent(const Point* polygon, int size, Point point);
+
+  /**
+   * @brief The linear step of a gift wrapping, over any set of points.
+   * @return The index of the point that leaves no other point strictly to the right of the line from the current one to it,
+   * the farthest one if several are collinear, or -1 if every point is equal to the current one.
+   */
+  static int findWrapStep(const Point* points, int size, Point point);
+public:
+  BasicConvexHull() {}
+
+  /**
+   * @brief Builds the hull of points already sorted by x, then y.
+   * @param points The sorted points.
+   * @param count The number of points.
+   */
+  void build(const Point* points, size_t count);
+
+  /**
+   * @brief Builds the hull of unsorted points without sorting them globally.
+   *
+   * The points are cut in chunks that are sorted and reduced to their own hull in parallel;
+   * only the vertices of these hulls are then sorted together and go through the final monotone chain.
+   * The result is the same as build() on all the sorted points.
+   *
+   * @param points The points; each chunk of them gets sorted in place.
+   * @param count The number of points.
+   * @param pool The threads to run on.
+   */
+  void buildParallel(Point* points, size_t count, ThreadPool& pool);
+
+  /**
+   * @brief Builds the hull with Chan's algorithm, in O(n log h) for a hull of h vertices.
+   *
+   * For growing guesses m of the hull size, the points are split in groups of m whose hulls are built in parallel,
+   * then the hull is gift wrapped for at most m steps, finding the next vertex of each group hull by a tangent search.
+   * The result is the same as build() on all the sorted points.
+   *
+   * @param points The points; each group of them gets sorted in place.
+   * @param count The number of points.
+   * @param pool The threads to run on.
+   * @param hullSizeGuess The first guess of the hull size, squared until the hull fits.
+   */
+  void buildChan(Point* points, size_t count, ThreadPool& pool, size_t hullSizeGuess = 4);
+
+  /**
+   * @brief Estimates whether a hull is small, from the hull of a sample of the points.
+   * @param points The points.
+   * @param count The number of points.
+   * @return The number of vertices of the sample hull.
+   */
+  static size_t sampleHullSize(const Point* points, size_t count);
+
+  /**
+   * @brief Extends the hull with more points, keeping only hull vertices in memory between calls.
+   *
+   * The hull of the new points is built in parallel, then merged with the current hull.
+   * Extending an empty hull chunk after chunk gives the same result as build() on all the sorted points.
+   *
+   * @param points The new points; each chunk of them gets sorted in place.
+   * @param count The number of new points.
+   * @param pool The threads to run on.
+   */
+  void extend(Point* points, size_t count, ThreadPool& pool);
+
+  /**
+   * @brief Akl-Toussaint heuristic: keeps only the points that are not strictly inside the octagon
+   * of the extreme points in x, y, x + y and x - y, since these cannot be hull vertices.
+   * @param points The points.
+   * @param count The number of points.
+   * @param survivors Receives the points that may be hull vertices, in their original order.
+   * @param pool The threads to run on.
+   * @return The number of discarded points.
+   */
+  static size_t prefilter(const Point* points, size_t count, vector<Point>& survivors, ThreadPool& pool);
+
+  /**
+   * @return The lower chain, from the smallest point to the largest one.
+   */
+  const vector<Point>& getLower() const { return lower; }
+
+  /**
+   * @return The upper chain, from the largest point back to the smallest one.
+   */
+  const vector<Point>& getUpper() const { return upper; }
+};
+
+typedef BasicConvexHull<ll> ConvexHull;
+
+template <class T>
+void BasicConvexHull<T>::buildChain(const Point* points, size_t count, bool reversed, vector<Point>& chain) {
+  chain.clear();
+  for (size_t i = 0; i < count; i++) {
+    const Point& point = points[reversed ? count - 1 - i : i];
+    while (chain.size() >= 2 && orientationTest(chain[chain.size() - 2], chain[chain.size() - 1], point) <= 0) {
+      GEO_COUNT(HULL_POPS, 1);
+      chain.pop_back();
+    }
+    chain.push_back(point);
+  }
+}
+
+template <class T>
+void BasicConvexHull<T>::build(const Point* points, size_t count) {
+  buildChain(points, count, false, lower);
+  buildChain(points, count, true, upper);
+}
+
+template <class T>
+void BasicConvexHull<T>::buildParallel(Point* points, size_t count, ThreadPool& pool) {
+  GEO_PHASE("hull");
+  if (pool.getThreadsCount() == 1 || count < PARALLEL_THRESHOLD) {
+    sort(points, points + count);
+    build(points, count);
+    return;
+  }
+
+  // A strict vertex of the whole hull is a strict vertex of the hull of its chunk,
+  // so the hull of the chunk hulls is the hull of all the points
+  size_t chunksCount = pool.getThreadsCount() * 4;
+  vector<vector<Point>> candidates(chunksCount);
+  pool.parallelFor(chunksCount, 1, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      Point* begin = points + count / chunksCount * i;
+      Point* end = i + 1 == chunksCount ? points + count : points + count / chunksCount * (i + 1);
+      sort(begin, end);
+      BasicConvexHull chunkHull;
+      chunkHull.build(begin, end - begin);
+      chunkHull.appendVertices(candidates[i]);
+    }
+  });
+
+  vector<Point> merged;
+  for (auto& chunkCandidates : candidates)
+    merged.insert(merged.end(), chunkCandidates.begin(), chunkCandidates.end());
+  sort(merged.begin(), merged.end());
+  build(merged.data(), merged.size());
+}
+
+template <class T>
+int BasicConvexHull<T>::findTangent(const Point* polygon, int size, Point point) {
+  // Only compared between points collinear with the given one, where the Manhattan distance orders them
+  // like the Euclidean one without squaring the coordinates; it is summed in 128 bits, where it cannot overflow
+  auto distance = [&](Point other) {
+    __int128 dx = (__int128)other.getX() - point.getX(), dy = (__int128)other.getY() - point.getY();
+    return (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+  };
+  auto isTangent = [&](int i) {
+    Point vertex = polygon[i];
+    Point previous = polygon[(i + size - 1) % size];
+    Point next = polygon[(i + 1) % size];
+    if (vertex == point)
+      return false;
+    ll before = orientationTest(point, vertex, previous);
+    ll after = orientationTest(point, vertex, next);
+    if (before < 0 || after < 0)
+      return false;
+    return (before > 0 || distance(previous) <= distance(vertex)) && (after > 0 || distance(next) <= distance(vertex));
+  };
+
+  if (size > 3) {
+    // Seen from the point, the vertices turn counterclockwise from the tangent to the opposite tangent, then back
+    int left = 0, right = size;
+    while (left < right) {
+      if (isTangent(left))
+        return left;
+      int middle = (left + right) / 2;
+      if (isTangent(middle))
+        return middle;
+      ll leftAfter = orientationTest(point, polygon[left], polygon[(left + 1) % size]);
+      ll middleAfter = orientationTest(point, polygon[middle], polygon[(middle + 1) % size]);
+      ll middleSide = orientationTest(point, polygon[left], polygon[middle]);
+      bool tangentBefore;
+      if (middleAfter > 0)
+        tangentBefore = leftAfter > 0 ? middleSide < 0 : true;
+      else
+        tangentBefore = leftAfter < 0 ? middleSide > 0 : false;
+      if (tangentBefore)
+        right = middle;
+      else
+        left = middle + 1;
+    }
+  }
+  return findWrapStep(polygon, size, point);
+}
+
+template <class T>
+int BasicConvexHull<T>::findWrapStep(const Point* points, int size, Point point) {
+  // Only compared between points collinear with the given one, where the Manhattan distance orders them
+  // like the Euclidean one without squaring the coordinates; it is summed in 128 bits, where it cannot overflow
+  auto distance = [&](Point other) {
+    __int128 dx = (__int128)other.getX() - point.getX(), dy = (__int128)other.getY() - point.getY();
+    return (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+  };
+  int best = -1;
+  for (int i = 0; i < size; i++) {
+    if (points[i] == point)
+      continue;
+    if (best == -1) {
+      best = i;
+      continue;
+    }
+    ll orientation = orientationTest(point, points[best], points[i]);
+    if (orientation < 0 || (orientation == 0 && distance(points[i]) > distance(points[best])))
+      best = i;
+  }
+  return best;
+}
+
+template <class T>
+void BasicConvexHull<T>::buildChan(Point* points, size_t count, ThreadPool& pool, size_t hullSizeGuess) {
+  GEO_PHASE("hull");
+  Point start = count == 0 ? Point() : *min_element(points, points + count);
+  // The group hulls of every round are stored at the start of their group, in one buffer shared by the rounds
+  vector<Point> groupHulls;
+  vector<int> groupHullSizes;
+  for (size_t groupSize = max<size_t>(hullSizeGuess, 4); ; groupSize = groupSize < (1ULL << 32) ? groupSize * groupSize : count) {
+    if (groupSize >= count) {
+      sort(points, points + count);
+      build(points, count);
+      return;
+    }
+
+    // The hull of every group, as a counterclockwise polygon
+    size_t groupsCount = (count + groupSize - 1) / groupSize;
+    groupHulls.resize(count);
+    groupHullSizes.resize(groupsCount);
+    pool.parallelFor(groupsCount, 0, [&](size_t first, size_t last) {
+      BasicConvexHull groupHull;
+      for (size_t i = first; i < last; i++) {
+        Point* begin = points + i * groupSize;
+        Point* end = points + min(count, (i + 1) * groupSize);
+        sort(begin, end);
+        groupHull.build(begin, end - begin);
+        Point* hull = groupHulls.data() + i * groupSize;
+        Point* hullEnd = copy(groupHull.lower.begin(), groupHull.lower.end(), hull);
+        if (groupHull.upper.size() > 2)
+          hullEnd = copy(groupHull.upper.begin() + 1, groupHull.upper.end() - 1, hullEnd);
+        groupHullSizes[i] = hullEnd - hull;
+      }
+    });
+
+    // Gift wrap from the smallest point, which is a hull vertex, for at most groupSize steps
+    vector<Point> vertices(1, start);
+    vector<int> tangents(groupsCount);
+    bool closed = false;
+    while (!closed && vertices.size() <= groupSize) {
+      Point current = vertices.back();
+      pool.parallelFor(groupsCount, 0, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+          tangents[i] = findTangent(groupHulls.data() + i * groupSize, groupHullSizes[i], current);
+      });
+      vector<Point> candidates;
+      for (size_t i = 0; i < groupsCount; i++)
+        if (tangents[i] != -1)
+          candidates.push_back(groupHulls[i * groupSize + tangents[i]]);
+      int next = findWrapStep(candidates.data(), candidates.size(), current);
+      if (next == -1) {
+        // Every point is equal to the start
+        build(points, min<size_t>(count, 2));
+        return;
+      }
+      closed = candidates[next] == start;
+      if (!closed)
+        vertices.push_back(candidates[next]);
+    }
+    if (!closed)
+      continue;
+
+    sort(vertices.begin(), vertices.end());
+    build(vertices.data(), vertices.size());
+    return;
+  }
+}
+
+template <class T>
+size_t BasicConvexHull<T>::sampleHullSize(const Point* points, size_t count) {
+  const size_t sampleSize = 4096;
+  vector<Point> sample;
+  size_t step = max<size_t>(count / sampleSize, 1);
+  for (size_t i = 0; i < count; i += step)
+    sample.push_back(points[i]);
+  sort(sample.begin(), sample.end());
+  BasicConvexHull sampleHull;
+  sampleHull.build(sample.data(), sample.size());
+  return sampleHull.lower.size() + sampleHull.upper.size();
+}
+
+template <class T>
+void BasicConvexHull<T>::appendVertices(vector<Point>& vertices) const {
+  vertices.insert(vertices.end(), lower.begin(), lower.end());
+  vertices.insert(vertices.end(), upper.begin(), upper.end());
+}
+
+template <class T>
+void BasicConvexHull<T>::extend(Point* points, size_t count, ThreadPool& pool) {
+  GEO_PHASE("hull");
+  BasicConvexHull added;
+  added.buildParallel(points, count, pool);
+  vector<Point> merged;
+  appendVertices(merged);
+  added.appendVertices(merged);
+  sort(merged.begin(), merged.end());
+  build(merged.data(), merged.size());
+}
+
+template <class T>
+size_t BasicConvexHull<T>::prefilter(const Point* points, size_t count, vector<Point>& survivors, ThreadPool& pool) {
+  survivors.clear();
+  if (count == 0)
+    return 0;
+
+  // The extreme point in each of 8 directions, counterclockwise from -x, is the one maximizing dx * x + dy * y
+  const int directionX[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+  const int directionY[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+  size_t chunksCount = min<size_t>(pool.getThreadsCount() * 4, count);
+  auto chunkBegin = [&](size_t i) { return count / chunksCount * i; };
+  auto chunkEnd = [&](size_t i) { return i + 1 == chunksCount ? count : count / chunksCount * (i + 1); };
+
+  // The sums are taken in 128 bits, where two coordinates of any size cannot overflow
+  vector<vector<Point>> chunkExtremes(chunksCount, vector<Point>(8));
+  pool.parallelFor(chunksCount, 1, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      __int128 best[8];
+      for (int d = 0; d < 8; d++) {
+        chunkExtremes[i][d] = points[chunkBegin(i)];
+        best[d] = directionX[d] * (__int128)points[chunkBegin(i)].getX() + directionY[d] * (__int128)points[chunkBegin(i)].getY();
+      }
+      for (size_t j = chunkBegin(i); j < chunkEnd(i); j++)
+        for (int d = 0; d < 8; d++) {
+          __int128 value = directionX[d] * (__int128)points[j].getX() + directionY[d] * (__int128)points[j].getY();
+          if (value > best[d]) {
+            best[d] = value;
+            chunkExtremes[i][d] = points[j];
+          }
+        }
+    }
+  });
+  Point extremes[8];
+  for (int d = 0; d < 8; d++) {
+    extremes[d] = chunkExtremes[0][d];
+    __int128 best = directionX[d] * (__int128)extremes[d].getX() + directionY[d] * (__int128)extremes[d].getY();
+    for (size_t i = 1; i < chunksCount; i++) {
+      __int128 value = directionX[d] * (__int128)chunkExtremes[i][d].getX() + directionY[d] * (__int128)chunkExtremes[i][d].getY();
+      if (value > best) {
+        best = value;
+        extremes[d] = chunkExtremes[i][d];
+      }
+    }
+  }
+
+  // A point is strictly inside the octagon if it is strictly left of every edge: a * x + b * y > c.
+  // Edges between equal extremes are skipped; a degenerate octagon then has no strict inside.
+  // The extremes bound every point, so when they fit the orientation fast path the plain 64-bit form is exact
+  // for the whole dataset; otherwise every test goes through orientationTest.
+  ll edgeA[8], edgeB[8], edgeC[8];
+  Point edgeStart[8], edgeEnd[8];
+  int edgesCount = 0;
+  bool fastPath = true;
+  for (int d = 0; d < 8; d++)
+    fastPath &= fitsOrientationFastPath(extremes[d].getX()) && fitsOrientationFastPath(extremes[d].getY());
+  for (int d = 0; d < 8; d++) {
+    Point start = extremes[d];
+    Point end = extremes[(d + 1) % 8];
+    if (start == end)
+      continue;
+    edgeStart[edgesCount] = start;
+    edgeEnd[edgesCount] = end;
+    if (fastPath) {
+      edgeA[edgesCount] = (ll)start.getY() - end.getY();
+      edgeB[edgesCount] = (ll)end.getX() - start.getX();
+      edgeC[edgesCount] = edgeA[edgesCount] * start.getX() + edgeB[edgesCount] * start.getY();
+    }
+    edgesCount++;
+  }
+  if (edgesCount < 3) {
+    survivors.assign(points, points + count);
+    return 0;
+  }
+
+  vector<vector<Point>> chunkSurvivors(chunksCount);
+  pool.parallelFor(chunksCount, 1, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++)
+      for (size_t j = chunkBegin(i); j < chunkEnd(i); j++) {
+        ll x = points[j].getX(), y = points[j].getY();
+        bool inside = true;
+        if (fastPath)
+          for (int e = 0; e < edgesCount; e++)
+            inside &= edgeA[e] * x + edgeB[e] * y > edgeC[e];
+        else
+          for (int e = 0; e < edgesCount && inside; e++)
+            inside = orientationTest(edgeStart[e], edgeEnd[e], points[j]) > 0;
+        if (!inside)
+          chunkSurvivors[i].push_back(points[j]);
+      }
+  });
+  for (auto& chunk : chunkSurvivors)
+    survivors.insert(survivors.end(), chunk.begin(), chunk.end());
+  return count - survivors.size();
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef CONVEX_LOCATOR_H
+#define CONVEX_LOCATOR_H
+
+#include <vector>
+#include <algorithm>
+#include "geometric_basics.h"
+#include "point_location.h"
+
+using namespace std;
+
+/**
+ * @brief A point location index for convex polygons, answering in O(log N).
+ *
+ * The polygon is seen as a fan of triangles around its first vertex. A query binary searches the wedge
+ * of the fan containing the point, then only tests the polygon edge closing that wedge.
+ */
+class ConvexLocator {
+private:
+  vector<Point> vertices; /**< The polygon vertices, counterclockwise, without collinear vertices. */
+  bool convex;
+public:
+  ConvexLocator() : convex(false) {}
+
+  /**
+   * @brief Checks the polygon once and indexes it if it is convex.
+   * @param polygon The polygon to index.
+   * @return True if the polygon is convex and can be queried.
+   */
+  bool build(const Polygon& polygon);
+
+  /**
+   * @return True if the last polygon built is convex.
+   */
+  bool isConvex() const { return convex; }
+
+  /**
+   * @brief Checks if a polygon is convex: every turn goes the same way, and the polygon winds only once.
+   * @param polygon The polygon to check.
+   * @return True if the polygon is convex, with at least three vertices where it turns.
+   */
+  static bool isConvex(const Polygon& polygon);
+
+  /**
+   * @brief Determines the position of a point with respect to the indexed convex polygon.
+   * @param point The point to be tested.
+   * @return The position of the point: INSIDE, OUTSIDE, or BOUNDARY.
+   */
+  PointPosition getPointPosition(Point point) const;
+};
+
+bool ConvexLocator::isConvex(const Polygon& polygon) {
+  int n = polygon.getSize();
+  if (n < 3)
+    return false;
+
+  int turnSign = 0, turnsCount = 0;
+  int xSignChanges = 0, ySignChanges = 0;
+  int lastXSign = 0, lastYSign = 0, firstXSign = 0, firstYSign = 0;
+  for (int i = 0; i < n; i++) {
+    Point p1 = polygon.getPoint(i);
+    Point p2 = polygon.getPoint((i + 1) % n);
+    Point p3 = polygon.getPoint((i + 2) % n);
+    ll orientation = orientationTest(p1, p2, p3);
+    if (orientation != 0) {
+      int sign = orientation > 0 ? 1 : -1;
+      if (turnSign != 0 && sign != turnSign)
+        return false;
+      turnSign = sign;
+      turnsCount++;
+    }
+
+    // A convex polygon goes left then right (and up then down) only once; a star with all turns alike does not
+    int xSign = (p2.getX() > p1.getX()) - (p2.getX() < p1.getX()), ySign = (p2.getY() > p1.getY()) - (p2.getY() < p1.getY());
+    if (xSign != 0) {
+      if (lastXSign != 0 && xSign != lastXSign)
+        xSignChanges++;
+      if (firstXSign == 0)
+        firstXSign = xSign;
+      lastXSign = xSign;
+    }
+    if (ySign != 0) {
+      if (lastYSign != 0 && ySign != lastYSign)
+        ySignChanges++;
+      if (firstYSign == 0)
+        firstYSign = ySign;
+      lastYSign = ySign;
+    }
+  }
+  if (lastXSign != firstXSign)
+    xSignChanges++;
+  if (lastYSign != firstYSign)
+    ySignChanges++;
+  // Fewer than three strict turns is a degenerate polygon, such as [A, B, C, A] whose closing edges go back
+  // through its first vertex: it has no area, and no fan to search
+  return turnsCount >= 3 && xSignChanges <= 2 && ySignChanges <= 2;
+}
+
+bool ConvexLocator::build(const Polygon& polygon) {
+  GEO_PHASE("prepare");
+  vertices.clear();
+  convex = isConvex(polygon);
+  if (!convex)
+    return false;
+
+  for (int i = 0; i < polygon.getSize(); i++)
+    vertices.push_back(polygon.getPoint(i));
+  // The wedges need strict turns, dropping collinear vertices leaves the same boundary
+  vector<Point> strict;
+  int n = vertices.size();
+  for (int i = 0; i < n; i++)
+    if (orientationTest(vertices[(i + n - 1) % n], vertices[i], vertices[(i + 1) % n]) != 0)
+      strict.push_back(vertices[i]);
+  vertices.swap(strict);
+  if (orientationTest(vertices[0], vertices[1], vertices[2]) < 0)
+    reverse(vertices.begin(), vertices.end());
+  return true;
+}
+
+PointPosition ConvexLocator::getPointPosition(Point point) const {
+  int n = vertices.size();
+  Point pivot = vertices[0];
+
+  // Outside the fan, or on one of the two edges bounding it
+  ll firstSide = orientationTest(pivot, vertices[1], point);
+  ll lastSide = orientationTest(pivot, vertices[n - 1], point);
+  if (firstSide < 0 || lastSide > 0)
+    return OUTSIDE;
+  if (firstSide == 0)
+    return pointOnSegment(point, pivot, vertices[1]) ? BOUNDARY : OUTSIDE;
+  if (lastSide == 0)
+    return pointOnSegment(point, pivot, vertices[n - 1]) ? BOUNDARY : OUTSIDE;
+
+  // The last vertex i such that the point is not on the right of the diagonal from the pivot to it
+  int low = 1, high = n - 1;
+  while (high - low > 1) {
+    int middle = (low + high) / 2;
+    if (orientationTest(pivot, vertices[middle], point) >= 0)
+      low = middle;
+    else
+      high = middle;
+  }
+
+  ll orientation = orientationTest(vertices[low], vertices[low + 1], point);
+  if (orientation > 0) return INSIDE;
+  if (orientation == 0) return BOUNDARY;
+  return OUTSIDE;
+}
+
+#endif
@@ -0,0 +1,443 @@
+#ifndef DENSITY_MAP_H
+#define DENSITY_MAP_H
+
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "geometric_basics.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/**
+ * @brief Aggregates a huge point set into a per-pixel, per-class histogram and colors it into a single image.
+ *
+ * The screen is split in square tiles that are recomputed independently, in parallel, and only when needed:
+ * a pan shifts the histogram and only recomputes the tiles uncovered at the border, a zoom recomputes every tile.
+ * The points are sorted once along a Z-order curve over their bounding square, so every cell of the quadtree
+ * splitting that square is a range of the sorted points. The cells holding more than LEAF_SIZE points are split,
+ * and every cell keeps its per-class counts: a tile adds the counts of the cells smaller than a pixel as a whole,
+ * and only visits the points of the leaves larger than a pixel. Either way the cost of a frame depends on the number
+ * of pixels instead of the number of points.
+ *
+ * @note The map keeps indexes into the points given to setPoints, which must outlive it.
+ */
+class DensityMap {
+private:
+  static const int TILE_SIZE = 32;
+  static const uint32_t LEAF_SIZE = 32;
+  static const int LEVELS = 16; /**< The depth of the quadtree, each level taking one bit of every coordinate. */
+
+  /**
+   * @brief A cell of the quadtree, holding the sorted points in [first, last).
+   */
+  struct Node {
+    uint32_t first, last;
+    int32_t children; /**< The first of the 4 consecutive child cells, -1 for a leaf. */
+  };
+
+  int width, height;
+  int classesCount;
+  int tilesX, tilesY;
+
+  double centerX, centerY; /**< The world coordinates at the middle of the screen. */
+  double unitsPerPixel;
+
+  vector<uint32_t> counts; /**< The histogram, pixel by pixel, classesCount counters per pixel. */
+  vector<char> dirtyTiles;
+  vector<uint32_t> pixels; /**< The colored histogram, as ARGB8888. */
+  vector<array<uint8_t, 3>> colors; /**< The color of each class. */
+
+  // The points of the caller, one of the two being set
+  const BasicPoint<int32_t>* narrowPoints;
+  const Point* widePoints;
+
+  vector<uint32_t> order; /**< The indexes of the points, sorted along the Z-order curve. */
+  vector<uint8_t> orderClasses; /**< The class of every point, in the same order. */
+  vector<uint32_t> orderCodes; /**< The Z-order code of every point, in the same order. */
+  vector<Node> nodes; /**< The quadtree, the root first. */
+  vector<uint32_t> nodeCounts; /**< classesCount counters for every node. */
+  double minX, minY, span; /**< The bounding square of the points, covered by the root. */
+
+  void markAllDirty() { fill(dirtyTiles.begin(), dirtyTiles.end(), 1); }
+  void setSource(const BasicPoint<int32_t>* points) { narrowPoints = points; widePoints = nullptr; }
+  void setSource(const Point* points) { narrowPoints = nullptr; widePoints = points; }
+  Point getPoint(uint32_t index) const { return widePoints != nullptr ? widePoints[index] : Point(narrowPoints[index]); }
+
+  /**
+   * @brief Splits a node while it holds more than LEAF_SIZE points, and sums its counts.
+   */
+  void buildNode(int node, int level);
+
+  /**
+   * @brief Adds the points of a node that land in a tile to the histogram.
+   * @param bounds The world rectangle of the tile: left, right, bottom and top.
+   */
+  void addNode(int node, int level, double cellX, double cellY, const array<double, 4>& bounds, const array<int, 4>& tile);
+  void addToPixel(double x, double y, const uint32_t* classCounts, int classOf, const array<int, 4>& tile);
+  void updateTile(int tileX, int tileY);
+public:
+  /**
+   * @brief The number of points above which aggregating them is faster than drawing each one.
+   */
+  static const size_t POINTS_THRESHOLD = 200000;
+
+  /**
+   * @param width The width of the image, in pixels.
+   * @param height The height of the image, in pixels.
+   * @param colors The color of each class of points, as red, green and blue.
+   */
+  DensityMap(int width, int height, vector<array<uint8_t, 3>> colors);
+
+  /**
+   * @brief Replaces the aggregated points.
+   * @param points The points, with int32 or ll coordinates; they are not copied, and must outlive the map.
+   * @param count The number of points, below 2^32.
+   * @param classOf Gives the class of the point at an index, smaller than the number of colors.
+   * @param pool The threads to run on.
+   */
+  template <class T, class ClassOf>
+  void setPoints(const BasicPoint<T>* points, size_t count, ClassOf classOf, ThreadPool& pool);
+
+  /**
+   * @brief Sets the view from scratch, which recomputes every tile.
+   * @param centerX The world x-coordinate at the middle of the image.
+   * @param centerY The world y-coordinate at the middle of the image.
+   * @param unitsPerPixel The world size of a pixel.
+   */
+  void setView(double centerX, double centerY, double unitsPerPixel);
+
+  /**
+   * @brief Moves the content of the image by a number of pixels, recomputing only the uncovered tiles.
+   * @param dx The horizontal move, positive to the right.
+   * @param dy The vertical move, positive downwards.
+   */
+  void pan(int dx, int dy);
+
+  /**
+   * @brief Zooms around a pixel, which keeps showing the same world point.
+   * @param factor The zoom factor, greater than 1 to zoom in.
+   * @param pixelX The x-coordinate of the pixel.
+   * @param pixelY The y-coordinate of the pixel.
+   */
+  void zoom(double factor, int pixelX, int pixelY);
+
+  /**
+   * @brief Recomputes the dirty tiles and colors the image.
+   * @param pool The threads to run on.
+   */
+  void update(ThreadPool& pool);
+
+  /**
+   * @return The image, row by row, as ARGB8888 pixels.
+   */
+  const uint32_t* getPixels() const { return pixels.data(); }
+
+  double getCenterX() const { return centerX; }
+  double getCenterY() const { return centerY; }
+  double getUnitsPerPixel() const { return unitsPerPixel; }
+};
+
+DensityMap::DensityMap(int width, int height, vector<array<uint8_t, 3>> colors): width(width), height(height), colors(colors) {
+  classesCount = colors.size();
+  tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+  tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+  centerX = centerY = 0;
+  unitsPerPixel = 1;
+  counts.assign((size_t)width * height * classesCount, 0);
+  dirtyTiles.assign(tilesX * tilesY, 1);
+  pixels.assign((size_t)width * height, 0xFFFFFFFF);
+  narrowPoints = nullptr;
+  widePoints = nullptr;
+  minX = minY = 0;
+  span = 1;
+}
+
+template <class T, class ClassOf>
+void DensityMap::setPoints(const BasicPoint<T>* points, size_t count, ClassOf classOf, ThreadPool& pool) {
+  setSource(points);
+  nodes.clear();
+  nodeCounts.clear();
+
+  // Every thread works on its own chunk of the points, for the bounding box and then for the sort
+  size_t chunksCount = max<size_t>(1, min<size_t>(pool.getThreadsCount() * 4, count / 65536));
+  vector<size_t> bounds(chunksCount + 1);
+  for (size_t i = 0; i <= chunksCount; i++)
+    bounds[i] = count / chunksCount * i;
+  bounds[chunksCount] = count;
+
+  vector<array<double, 4>> chunkBoxes(chunksCount, array<double, 4>{ INFINITY, INFINITY, -INFINITY, -INFINITY });
+  pool.parallelFor(chunksCount, 1, [&](size_t first, size_t last) {
+    for (size_t chunk = first; chunk < last; chunk++)
+      for (size_t i = bounds[chunk]; i < bounds[chunk + 1]; i++) {
+        array<double, 4>& box = chunkBoxes[chunk];
+        double x = points[i].getX(), y = points[i].getY();
+        box = { min(box[0], x), min(box[1], y), max(box[2], x), max(box[3], y) };
+      }
+  });
+  array<double, 4> box = { 0, 0, 0, 0 };
+  if (count > 0)
+    box = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+  for (auto& chunkBox : chunkBoxes)
+    box = { min(box[0], chunkBox[0]), min(box[1], chunkBox[1]), max(box[2], chunkBox[2]), max(box[3], chunkBox[3]) };
+  minX = box[0];
+  minY = box[1];
+  span = max(box[2] - box[0], box[3] - box[1]) + 1;
+
+  // The key of a point is its Z-order code, interleaving 16 bits of each coordinate, above its index
+  auto spreadBits = [](uint64_t value) {
+    value = (value | value << 8) & 0x00FF00FF;
+    value = (value | value << 4) & 0x0F0F0F0F;
+    value = (value | value << 2) & 0x33333333;
+    return (value | value << 1) & 0x55555555;
+  };
+  auto quantize = [&](double offset) { return (uint64_t)min(65535.0, floor(offset / span * 65536)); };
+  vector<uint64_t> keys(count);
+  pool.parallelFor(count, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      uint64_t code = spreadBits(quantize(points[i].getX() - minX)) | spreadBits(quantize(points[i].getY() - minY)) << 1;
+      keys[i] = code << 32 | i;
+    }
+  });
+
+  // The chunks are sorted on their own threads, then merged by pairs until one run is left
+  pool.parallelFor(chunksCount, 1, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++)
+      sort(keys.begin() + bounds[i], keys.begin() + bounds[i + 1]);
+  });
+  for (size_t width = 1; width < chunksCount; width *= 2) {
+    size_t pairsCount = (chunksCount + 2 * width - 1) / (2 * width);
+    pool.parallelFor(pairsCount, 1, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; i++) {
+        size_t begin = 2 * width * i;
+        size_t middle = min(begin + width, chunksCount);
+        size_t end = min(begin + 2 * width, chunksCount);
+        inplace_merge(keys.begin() + bounds[begin], keys.begin() + bounds[middle], keys.begin() + bounds[end]);
+      }
+    });
+  }
+
+  order.resize(count);
+  orderCodes.resize(count);
+  orderClasses.resize(count);
+  pool.parallelFor(count, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      order[i] = (uint32_t)keys[i];
+      orderCodes[i] = keys[i] >> 32;
+      orderClasses[i] = classOf(order[i]);
+    }
+  });
+  vector<uint64_t>().swap(keys);
+
+  if (count > 0) {
+    nodes.push_back(Node{ 0, (uint32_t)count, -1 });
+    nodeCounts.assign(classesCount, 0);
+    buildNode(0, 0);
+  }
+  markAllDirty();
+}
+
+void DensityMap::buildNode(int node, int level) {
+  uint32_t first = nodes[node].first, last = nodes[node].last;
+  if (last - first <= LEAF_SIZE || level == LEVELS) {
+    for (uint32_t i = first; i < last; i++)
+      nodeCounts[(size_t)node * classesCount + orderClasses[i]]++;
+    return;
+  }
+
+  // The child of a point is given by the bits of its code at this level, the y bit above the x bit
+  int shift = 2 * (LEVELS - 1 - level);
+  int children = nodes.size();
+  nodes[node].children = children;
+  uint32_t start = first;
+  for (uint64_t quadrant = 0; quadrant < 4; quadrant++) {
+    uint32_t end = partition_point(orderCodes.begin() + start, orderCodes.begin() + last, [&](uint32_t code) {
+      return (code >> shift & 3) <= quadrant;
+    }) - orderCodes.begin();
+    nodes.push_back(Node{ start, end, -1 });
+    start = end;
+  }
+  nodeCounts.resize(nodes.size() * classesCount, 0);
+  for (int child = children; child < children + 4; child++) {
+    buildNode(child, level + 1);
+    for (int c = 0; c < classesCount; c++)
+      nodeCounts[(size_t)node * classesCount + c] += nodeCounts[(size_t)child * classesCount + c];
+  }
+}
+
+void DensityMap::setView(double centerX, double centerY, double unitsPerPixel) {
+  this->centerX = centerX;
+  this->centerY = centerY;
+  this->unitsPerPixel = unitsPerPixel;
+  markAllDirty();
+}
+
+void DensityMap::pan(int dx, int dy) {
+  if (dx == 0 && dy == 0)
+    return;
+  centerX -= dx * unitsPerPixel;
+  centerY += dy * unitsPerPixel;
+  if (abs(dx) >= width || abs(dy) >= height) {
+    markAllDirty();
+    return;
+  }
+
+  // Move the histogram, the uncovered pixels start empty
+  size_t rowSize = (size_t)width * classesCount;
+  vector<uint32_t> moved(counts.size(), 0);
+  for (int y = max(0, dy); y < min(height, height + dy); y++) {
+    int fromX = max(0, -dx), toX = max(0, dx), length = width - abs(dx);
+    copy(counts.begin() + (y - dy) * rowSize + (size_t)fromX * classesCount,
+         counts.begin() + (y - dy) * rowSize + (size_t)(fromX + length) * classesCount,
+         moved.begin() + y * rowSize + (size_t)toX * classesCount);
+  }
+  counts.swap(moved);
+
+  // A tile is still valid only if every one of its pixels came from a valid tile
+  vector<char> dirty(tilesX * tilesY, 0);
+  for (int tileY = 0; tileY < tilesY; tileY++) {
+    for (int tileX = 0; tileX < tilesX; tileX++) {
+      int left = tileX * TILE_SIZE - dx, right = min(width, (tileX + 1) * TILE_SIZE) - 1 - dx;
+      int top = tileY * TILE_SIZE - dy, bottom = min(height, (tileY + 1) * TILE_SIZE) - 1 - dy;
+      if (left < 0 || top < 0 || right >= width || bottom >= height) {
+        dirty[tileY * tilesX + tileX] = 1;
+        continue;
+      }
+      for (int y = top / TILE_SIZE; y <= bottom / TILE_SIZE; y++)
+        for (int x = left / TILE_SIZE; x <= right / TILE_SIZE; x++)
+          if (dirtyTiles[y * tilesX + x])
+            dirty[tileY * tilesX + tileX] = 1;
+    }
+  }
+  dirtyTiles.swap(dirty);
+}
+
+void DensityMap::zoom(double factor, int pixelX, int pixelY) {
+  double worldX = centerX + (pixelX - width / 2.0) * unitsPerPixel;
+  double worldY = centerY - (pixelY - height / 2.0) * unitsPerPixel;
+  unitsPerPixel /= factor;
+  centerX = worldX - (pixelX - width / 2.0) * unitsPerPixel;
+  centerY = worldY + (pixelY - height / 2.0) * unitsPerPixel;
+  markAllDirty();
+}
+
+void DensityMap::addToPixel(double x, double y, const uint32_t* classCounts, int classOf, const array<int, 4>& tile) {
+  int pixelX = floor((x - centerX) / unitsPerPixel + width / 2.0);
+  int pixelY = floor((centerY - y) / unitsPerPixel + height / 2.0);
+  if (pixelX < tile[0] || pixelX >= tile[1] || pixelY < tile[2] || pixelY >= tile[3])
+    return;
+  uint32_t* pixel = &counts[((size_t)pixelY * width + pixelX) * classesCount];
+  if (classCounts == nullptr) {
+    pixel[classOf]++;
+    return;
+  }
+  for (int c = 0; c < classesCount; c++)
+    pixel[c] += classCounts[c];
+}
+
+void DensityMap::addNode(int node, int level, double cellX, double cellY, const array<double, 4>& bounds, const array<int, 4>& tile) {
+  const Node& cell = nodes[node];
+  double size = ldexp(span, -level);
+  if (cell.first == cell.last || cellX > bounds[1] || cellX + size < bounds[0] || cellY > bounds[3] || cellY + size < bounds[2])
+    return;
+
+  // A cell smaller than a pixel adds its counts to the pixel holding its center
+  if (size <= unitsPerPixel) {
+    addToPixel(cellX + size / 2, cellY + size / 2, &nodeCounts[(size_t)node * classesCount], 0, tile);
+    return;
+  }
+  if (cell.children < 0) {
+    // The points go to the center of their cell at the first level where a cell fits in a pixel, like the
+    // nodes do; only past the last level are the points themselves read
+    int pixelLevel = level;
+    while (pixelLevel < LEVELS && ldexp(span, -pixelLevel) > unitsPerPixel)
+      pixelLevel++;
+    double pixelSize = ldexp(span, -pixelLevel);
+    if (pixelSize <= unitsPerPixel) {
+      auto compactBits = [](uint32_t value) {
+        value &= 0x55555555;
+        value = (value | value >> 1) & 0x33333333;
+        value = (value | value >> 2) & 0x0F0F0F0F;
+        value = (value | value >> 4) & 0x00FF00FF;
+        return (value | value >> 8) & 0x0000FFFF;
+      };
+      int shift = 2 * (LEVELS - pixelLevel);
+      for (uint32_t i = cell.first; i < cell.last; i++) {
+        uint32_t code = shift < 32 ? orderCodes[i] >> shift : 0;
+        double x = minX + (compactBits(code) + 0.5) * pixelSize, y = minY + (compactBits(code >> 1) + 0.5) * pixelSize;
+        addToPixel(x, y, nullptr, orderClasses[i], tile);
+      }
+      return;
+    }
+    for (uint32_t i = cell.first; i < cell.last; i++) {
+      Point point = getPoint(order[i]);
+      addToPixel(point.getX(), point.getY(), nullptr, orderClasses[i], tile);
+    }
+    return;
+  }
+  for (int quadrant = 0; quadrant < 4; quadrant++)
+    addNode(cell.children + quadrant, level + 1, cellX + (quadrant & 1) * size / 2, cellY + (quadrant >> 1) * size / 2, bounds, tile);
+}
+
+void DensityMap::updateTile(int tileX, int tileY) {
+  int left = tileX * TILE_SIZE, right = min(width, left + TILE_SIZE);
+  int top = tileY * TILE_SIZE, bottom = min(height, top + TILE_SIZE);
+  for (int y = top; y < bottom; y++)
+    fill(counts.begin() + ((size_t)y * width + left) * classesCount, counts.begin() + ((size_t)y * width + right) * classesCount, 0);
+  if (nodes.empty())
+    return;
+
+  // The world rectangle of the tile
+  double worldLeft = centerX + (left - width / 2.0) * unitsPerPixel;
+  double worldRight = centerX + (right - width / 2.0) * unitsPerPixel;
+  double worldTop = centerY - (top - height / 2.0) * unitsPerPixel;
+  double worldBottom = centerY - (bottom - height / 2.0) * unitsPerPixel;
+  addNode(0, 0, minX, minY, { worldLeft, worldRight, worldBottom, worldTop }, { left, right, top, bottom });
+}
+
+void DensityMap::update(ThreadPool& pool) {
+  vector<int> tiles;
+  for (int i = 0; i < tilesX * tilesY; i++)
+    if (dirtyTiles[i])
+      tiles.push_back(i);
+  pool.parallelFor(tiles.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      updateTile(tiles[i] % tilesX, tiles[i] / tilesX);
+  });
+  fill(dirtyTiles.begin(), dirtyTiles.end(), 0);
+
+  uint32_t maxCount = 1;
+  for (size_t pixel = 0; pixel < (size_t)width * height; pixel++) {
+    uint32_t total = 0;
+    for (int c = 0; c < classesCount; c++)
+      total += counts[pixel * classesCount + c];
+    maxCount = max(maxCount, total);
+  }
+
+  // The hue is the mix of the classes in the pixel, the intensity grows with the logarithm of the count
+  double logMax = log(1.0 + maxCount);
+  pool.parallelFor(height, 0, [&](size_t begin, size_t end) {
+    for (size_t pixel = begin * width; pixel < end * width; pixel++) {
+      uint32_t total = 0;
+      double red = 0, green = 0, blue = 0;
+      for (int c = 0; c < classesCount; c++) {
+        uint32_t count = counts[pixel * classesCount + c];
+        total += count;
+        red += (double)count * colors[c][0];
+        green += (double)count * colors[c][1];
+        blue += (double)count * colors[c][2];
+      }
+      if (total == 0) {
+        pixels[pixel] = 0xFFFFFFFF;
+        continue;
+      }
+      double intensity = 0.35 + 0.65 * log(1.0 + total) / logMax;
+      auto channel = [&](double sum) { return (uint32_t)(255 - intensity * (255 - sum / total)); };
+      pixels[pixel] = 0xFF000000 | channel(red) << 16 | channel(green) << 8 | channel(blue);
+    }
+  });
+}
+
+#endif
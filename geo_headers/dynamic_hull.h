@@ -0,0 +1,100 @@
+#ifndef DYNAMIC_HULL_H
+#define DYNAMIC_HULL_H
+
+#include <vector>
+#include <set>
+#include <functional>
+#include "geometric_basics.h"
+
+using namespace std;
+
+/**
+ * @brief Orders points from the largest (by x, then y) to the smallest.
+ */
+struct ReversedPointOrder {
+  bool operator()(const Point& first, const Point& second) const { return second < first; }
+};
+
+/**
+ * @brief One chain of a dynamic convex hull: the strict vertices that make left turns when walked in the given order.
+ *
+ * Each inserted point is added and removed at most once, so insertions take O(log n) amortized time.
+ */
+template <class Order>
+class HullChain {
+private:
+  set<Point, Order> points;
+public:
+  /**
+   * @brief Adds a point to the chain, removing the vertices it hides.
+   * @param point The point to add.
+   * @return True if the point became a vertex of the chain.
+   */
+  bool insert(const Point& point);
+
+  /**
+   * @return The vertices of the chain, in walking order.
+   */
+  const set<Point, Order>& getPoints() const { return points; }
+};
+
+/**
+ * @brief A convex hull that is kept up to date while points are inserted one by one.
+ *
+ * The hull is stored as the same lower and upper chains the monotone chain algorithm builds,
+ * so it can be read at any time without recomputing it from all the inserted points.
+ */
+class DynamicHull {
+private:
+  HullChain<less<Point>> lower; /**< From the smallest point to the largest one. */
+  HullChain<ReversedPointOrder> upper; /**< From the largest point back to the smallest one. */
+public:
+  /**
+   * @brief Inserts a point in O(log n) amortized time.
+   * @param point The point to insert.
+   * @return True if the hull changed.
+   */
+  bool insert(const Point& point);
+
+  /**
+   * @param chain Receives the lower chain, from the smallest point to the largest one.
+   */
+  void getLower(vector<Point>& chain) const { chain.assign(lower.getPoints().begin(), lower.getPoints().end()); }
+
+  /**
+   * @param chain Receives the upper chain, from the largest point back to the smallest one.
+   */
+  void getUpper(vector<Point>& chain) const { chain.assign(upper.getPoints().begin(), upper.getPoints().end()); }
+
+  /**
+   * @return The number of points of both chains; the two extreme points belong to both of them.
+   */
+  size_t getSize() const { return lower.getPoints().size() + upper.getPoints().size(); }
+};
+
+template <class Order>
+bool HullChain<Order>::insert(const Point& point) {
+  auto following = points.lower_bound(point);
+  if (following != points.end() && *following == point)
+    return false;
+
+  // A point on or above the edge it falls under is not a strict vertex
+  if (following != points.end() && following != points.begin() && orientationTest(*std::prev(following), *following, point) >= 0)
+    return false;
+
+  auto inserted = points.insert(following, point);
+  following = std::next(inserted);
+  while (following != points.end() && std::next(following) != points.end() && orientationTest(point, *following, *std::next(following)) <= 0)
+    following = points.erase(following);
+  while (inserted != points.begin() && std::prev(inserted) != points.begin() && orientationTest(*std::prev(inserted, 2), *std::prev(inserted), point) <= 0)
+    points.erase(std::prev(inserted));
+  return true;
+}
+
+bool DynamicHull::insert(const Point& point) {
+  bool lowerChanged = lower.insert(point);
+  bool upperChanged = upper.insert(point);
+  return lowerChanged || upperChanged;
+}
+
+#endif
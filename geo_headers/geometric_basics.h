@@ -3,14 +3,37 @@
 
 #include <iostream>
 #include <vector>
+#include <cstdint>
+#include "instrumentation.h"
 
 typedef long long ll;
 
 using namespace std;
 
-class Point;
-class Line;
-class Polygon;
+template <class T> class BasicPoint;
+template <class T> class BasicLine;
+template <class T> class BasicPolygon;
+
+/**
+ * @brief The 64-bit integer geometry used everywhere unless a narrower coordinate type is asked for.
+ */
+typedef BasicPoint<ll> Point;
+typedef BasicLine<ll> Line;
+typedef BasicPolygon<ll> Polygon;
+
+/**
+ * @brief The bound of the orientation fast path: with every coordinate in [-2^30, 2^30), the differences stay
+ * below 2^31 and their products below 2^62, so the orientation is exact in 64 bits.
+ */
+const ll ORIENTATION_FAST_LIMIT = 1LL << 30;
+
+/**
+ * @brief The arithmetic of a coordinate type: the wider type its orientation is computed and returned in,
+ * chosen at compile time, and the orientation itself.
+ *
+ * Only int32_t, ll and double coordinates are supported.
+ */
+template <class T> struct CoordinateTraits;
 
 /**
  * @brief Performs the orientation test for three points in a 2D space.
@@ -24,8 +47,11 @@ class Polygon;
  *         - Positive value: Points p1, p2, p3 are in counterclockwise order.
  *         - Negative value: Points p1, p2, p3 are in clockwise order.
  *         - Zero value: Points p1, p2, p3 are collinear.
+ * @note For integer coordinates the result is always exact, but it is twice the signed area of the triangle
+ * only when it fits the 64-bit path (see ORIENTATION_FAST_LIMIT for ll); otherwise it is -1, 0 or 1.
  */
-ll orientationTest(Point p1, Point p2, Point p3);
+template <class T>
+inline typename CoordinateTraits<T>::Wide orientationTest(BasicPoint<T> p1, BasicPoint<T> p2, BasicPoint<T> p3);
 
 /**
  * @brief Performs the orientation test for a line segment and a point in a 2D space.
@@ -39,76 +65,99 @@ ll orientationTest(Point p1, Point p2, Point p3);
  *         - Negative value: The point is to the right of the line segment.
  *         - Zero value: The point is collinear with the line segment.
  */
-ll orientationTest(Line line, Point point);
+template <class T>
+inline typename CoordinateTraits<T>::Wide orientationTest(BasicLine<T> line, BasicPoint<T> point);
 
 /**
  * @brief Represents a 2D point with x and y coordinates.
+ * @tparam T The coordinate type: int32_t, ll or double.
  */
-class Point {
+template <class T>
+class BasicPoint {
 private:
-  ll x;
-  ll y;
+  T x;
+  T y;
 public:
-  Point();
-  Point(ll x, ll y);
+  typedef T Coordinate;
+
+  BasicPoint();
+  BasicPoint(T x, T y);
+
+  /**
+   * @brief Converts a point with another coordinate type; narrowing is only safe when the coordinates fit.
+   */
+  template <class U>
+  explicit BasicPoint(const BasicPoint<U>& point) : BasicPoint((T)point.getX(), (T)point.getY()) {}
 
-  void setPoint(ll x, ll y);
-  void setX(ll x);
-  void setY(ll y);
+  void setPoint(T x, T y);
+  void setX(T x);
+  void setY(T y);
 
-  ll getX();
-  ll getY();
+  T getX() const;
+  T getY() const;
 
-  bool operator==(const Point& point);
-  bool operator<(const Point& point) const;
-  Point& operator=(const Point& point);
-  friend ostream& operator<<(ostream& out, Point point);
-  friend istream& operator>>(istream& in, Point& point);
+  bool operator==(const BasicPoint& point) const;
+  bool operator<(const BasicPoint& point) const;
+  BasicPoint& operator=(const BasicPoint& point);
 };
 
-void Point::setPoint(ll x, ll y) {
+template <class T>
+void BasicPoint<T>::setPoint(T x, T y) {
   this->x = x;
   this->y = y;
 }
 
-Point::Point() {
+template <class T>
+BasicPoint<T>::BasicPoint() {
   setPoint(0, 0);
 }
-Point::Point(ll x, ll y) {
+template <class T>
+BasicPoint<T>::BasicPoint(T x, T y) {
   setPoint(x, y);
 }
 
-void Point::setX(ll x) { 
-  this->x = x; 
+template <class T>
+void BasicPoint<T>::setX(T x) {
+  this->x = x;
 }
-void Point::setY(ll y) { 
-  this->y = y; 
+template <class T>
+void BasicPoint<T>::setY(T y) {
+  this->y = y;
 }
 
-ll Point::getX() { return x; }
-ll Point::getY() { return y; }
+template <class T>
+T BasicPoint<T>::getX() const { return x; }
+template <class T>
+T BasicPoint<T>::getY() const { return y; }
 
-bool Point::operator==(const Point& point) {
+template <class T>
+bool BasicPoint<T>::operator==(const BasicPoint& point) const {
   return x == point.x && y == point.y;
 }
-bool Point::operator<(const Point& point) const{
+template <class T>
+bool BasicPoint<T>::operator<(const BasicPoint& point) const{
   // sorted by x, and if x are equal, sorted by y
   if (x == point.x)
     return y < point.y;
   else
     return x < point.x;
 }
-Point& Point::operator=(const Point& point) {
+template <class T>
+BasicPoint<T>& BasicPoint<T>::operator=(const BasicPoint& point) {
   x = point.x;
   y = point.y;
   return *this;
 }
-ostream& operator<<(ostream& out, Point point) {
-  out << "(" << point.x << ", " << point.y << ")";
+template <class T>
+ostream& operator<<(ostream& out, BasicPoint<T> point) {
+  out << "(" << point.getX() << ", " << point.getY() << ")";
   return out;
 }
-istream& operator>>(istream& in, Point& point) {
-  in >> point.x >> point.y;
+template <class T>
+istream& operator>>(istream& in, BasicPoint<T>& point) {
+  T x, y;
+  in >> x >> y;
+  point.setPoint(x, y);
   return in;
 }
 
@@ -116,74 +165,86 @@ istream& operator>>(istream& in, Point& point) {
 /**
  * @brief Represents a line segment defined by two points in a 2D space.
  */
-class Line {
+template <class T>
+class BasicLine {
 private:
-  Point startPoint;
-  Point endPoint;
+  BasicPoint<T> startPoint;
+  BasicPoint<T> endPoint;
 public:
-  Line();
-  Line(Point startPoint, Point endPoint);
-  Line(ll startPointX, ll startPointY, ll endPointX, ll endPointY);
+  BasicLine();
+  BasicLine(BasicPoint<T> startPoint, BasicPoint<T> endPoint);
+  BasicLine(T startPointX, T startPointY, T endPointX, T endPointY);
 
-  Point getStartPoint();
-  Point getEndPoint();
+  BasicPoint<T> getStartPoint() const;
+  BasicPoint<T> getEndPoint() const;
 
-  void setStartPoint(ll x, ll y);
-  void setStartPoint(Point point);
+  void setStartPoint(T x, T y);
+  void setStartPoint(BasicPoint<T> point);
 
-  void setEndPoint(ll x, ll y);
-  void setEndPoint(Point point);
+  void setEndPoint(T x, T y);
+  void setEndPoint(BasicPoint<T> point);
 
-  bool operator==(const Line& line);
-  Line& operator=(const Line& line);
-  friend ostream& operator<<(ostream& out, Line line);
+  bool operator==(const BasicLine& line);
+  BasicLine& operator=(const BasicLine& line);
 };
 
-Line::Line() { 
-  startPoint = Point();
-  endPoint = Point();
+template <class T>
+BasicLine<T>::BasicLine() {
+  startPoint = BasicPoint<T>();
+  endPoint = BasicPoint<T>();
 }
-Line::Line(Point startPoint, Point endPoint) {
+template <class T>
+BasicLine<T>::BasicLine(BasicPoint<T> startPoint, BasicPoint<T> endPoint) {
   this->startPoint = startPoint,
   this->endPoint = endPoint;
 }
-Line::Line(ll startPointX, ll startPointY, ll endPointX, ll endPointY) {
-  startPoint = Point(startPointX, startPointY);
-  endPoint = Point(endPointX, endPointY);
+template <class T>
+BasicLine<T>::BasicLine(T startPointX, T startPointY, T endPointX, T endPointY) {
+  startPoint = BasicPoint<T>(startPointX, startPointY);
+  endPoint = BasicPoint<T>(endPointX, endPointY);
 }
 
-Point Line::getStartPoint() {
+template <class T>
+BasicPoint<T> BasicLine<T>::getStartPoint() const {
   return startPoint;
 }
-Point Line::getEndPoint() {
+template <class T>
+BasicPoint<T> BasicLine<T>::getEndPoint() const {
   return endPoint;
 }
 
-void Line::setStartPoint(ll x, ll y) {
+template <class T>
+void BasicLine<T>::setStartPoint(T x, T y) {
   startPoint.setPoint(x, y);
 }
-void Line::setStartPoint(Point point) {
+template <class T>
+void BasicLine<T>::setStartPoint(BasicPoint<T> point) {
   startPoint = point;
 }
 
-void Line::setEndPoint(ll x, ll y) {
+template <class T>
+void BasicLine<T>::setEndPoint(T x, T y) {
   endPoint.setPoint(x, y);
 }
-void Line::setEndPoint(Point point) {
+template <class T>
+void BasicLine<T>::setEndPoint(BasicPoint<T> point) {
   endPoint = point;
 }
 
-bool Line::operator==(const Line& line) {
+template <class T>
+bool BasicLine<T>::operator==(const BasicLine& line) {
   return startPoint == line.startPoint && endPoint == line.endPoint;
 }
-Line& Line::operator=(const Line& line) {
+template <class T>
+BasicLine<T>& BasicLine<T>::operator=(const BasicLine& line) {
   setStartPoint(line.startPoint);
   setEndPoint(line.endPoint);
   return *this;
 }
 
-ostream& operator<<(ostream& out, Line line) {
-  out << line.startPoint << " -> " << line.endPoint;
+template <class T>
+ostream& operator<<(ostream& out, BasicLine<T> line) {
+  out << line.getStartPoint() << " -> " << line.getEndPoint();
   return out;
 }
 
@@ -191,22 +252,23 @@ ostream& operator<<(ostream& out, Line line) {
 /**
  * @brief Represents a polygon defined by a collection of points in a 2D space.
  */
-class Polygon {
+template <class T>
+class BasicPolygon {
 private:
-  vector<Point> points; /**< The points that define the polygon. */
-  ll rightExtreme; /**< The x-coordinate of the rightmost point in the polygon. */
-  ll leftExtreme; /**< The x-coordinate of the leftmost point in the polygon. */
-  ll topExtreme; /**< The y-coordinate of the topmost point in the polygon. */
-  ll bottomExtreme; /**< The y-coordinate of the bottommost point in the polygon. */
+  vector<BasicPoint<T>> points; /**< The points that define the polygon. */
+  T rightExtreme; /**< The x-coordinate of the rightmost point in the polygon. */
+  T leftExtreme; /**< The x-coordinate of the leftmost point in the polygon. */
+  T topExtreme; /**< The y-coordinate of the topmost point in the polygon. */
+  T bottomExtreme; /**< The y-coordinate of the bottommost point in the polygon. */
 public:
-  Polygon();
-  Polygon(vector<Point> points);
+  BasicPolygon();
+  BasicPolygon(vector<BasicPoint<T>> points);
 
   /**
    * @param index The index of the point to retrieve.
    * @return The point at the specified index.
    */
-  Point getPoint(int index);
+  BasicPoint<T> getPoint(int index) const;
 
   /**
    * @brief Removes the last point from the polygon.
@@ -216,14 +278,14 @@ public:
   /**
    * @return The number of points in the polygon.
    */
-  int getSize();
+  int getSize() const;
 
   /**
    * @brief Adds a new point to the polygon and updates the extreme coordinates.
    * @note The new point is collinear with the previous and last points, it is discarded to maintain a non-self-intersecting polygon.
    * @param newPoint The new point to be added to the polygon.
    */
-  void addPoint(Point& newPoint);
+  void addPoint(BasicPoint<T>& newPoint);
 
   /**
    * @brief Checks and removes the last point of the polygon if it is collinear with the previous and first points.
@@ -232,6 +294,7 @@ public:
 
   /**
    * @brief Reads the polygon data from an input stream.
+   * @note The polygon is closed with checkLastPoint(), so it can be shared as is by concurrent queries.
    * @param in The input stream to read the polygon data from.
    */
   void read(istream& in);
@@ -240,108 +303,188 @@ public:
    * @brief Getter for the rightmost x-coordinate of the polygon.
    * @return The rightmost x-coordinate of the polygon.
    */
-  ll getRightExtreme() { return rightExtreme; }
+  T getRightExtreme() const { return rightExtreme; }
 
   /**
    * @brief Getter for the leftmost x-coordinate of the polygon.
    * @return The leftmost x-coordinate of the polygon.
    */
-  ll getLeftExtreme() { return leftExtreme; }
+  T getLeftExtreme() const { return leftExtreme; }
 
   /**
    * @brief Getter for the topmost y-coordinate of the polygon.
    * @return The topmost y-coordinate of the polygon.
    */
-  ll getTopExtreme() { return topExtreme; }
+  T getTopExtreme() const { return topExtreme; }
 
    /**
    * @brief Getter for the bottommost y-coordinate of the polygon.
    * @return The bottommost y-coordinate of the polygon.
    */
-  ll getBottomExtreme() { return bottomExtreme; }
-
-  friend istream& operator>>(istream& in, Polygon& polygon);
+  T getBottomExtreme() const { return bottomExtreme; }
 };
 
-Polygon::Polygon() {
+template <class T>
+BasicPolygon<T>::BasicPolygon() {
   rightExtreme = 0;
   leftExtreme = 0;
   topExtreme = 0;
   bottomExtreme = 0;
 }
-Polygon::Polygon(vector<Point> points) {
-  for (auto point : points) 
+template <class T>
+BasicPolygon<T>::BasicPolygon(vector<BasicPoint<T>> points) : BasicPolygon() {
+  for (auto point : points)
     addPoint(point);
 }
 
-void Polygon::addPoint(Point& newPoint) {
+template <class T>
+void BasicPolygon<T>::addPoint(BasicPoint<T>& newPoint) {
+  if (points.empty()) {
+    rightExtreme = leftExtreme = newPoint.getX();
+    topExtreme = bottomExtreme = newPoint.getY();
+  }
+  rightExtreme = max(rightExtreme, newPoint.getX());
+  leftExtreme = min(leftExtreme, newPoint.getX());
+  topExtreme = max(topExtreme, newPoint.getY());
+  bottomExtreme = min(bottomExtreme, newPoint.getY());
+
   if (points.size() < 2) {
     points.push_back(newPoint);
     return;
   }
 
-  Point p1 = points[points.size() - 2];
-  Point p2 = points[points.size() - 1];
+  BasicPoint<T> p1 = points[points.size() - 2];
+  BasicPoint<T> p2 = points[points.size() - 1];
 
   // check for collinear points
   if (orientationTest(p1, p2, newPoint) == 0)
     points.pop_back();
-  points.push_back(newPoint);    
-
-  rightExtreme = max(rightExtreme, newPoint.getX());
-  leftExtreme = min(leftExtreme, newPoint.getX());
-  topExtreme = max(topExtreme, newPoint.getY());
-  bottomExtreme = min(bottomExtreme, newPoint.getY());
+  points.push_back(newPoint);
 }
 
-Point Polygon::getPoint(int index) {
+template <class T>
+BasicPoint<T> BasicPolygon<T>::getPoint(int index) const {
   return points[index];
 }
 
-int Polygon::getSize() {
+template <class T>
+int BasicPolygon<T>::getSize() const {
   return points.size();
 }
 
-void Polygon::removeLastPoint() {
+template <class T>
+void BasicPolygon<T>::removeLastPoint() {
   points.pop_back();
 }
 
-void Polygon::checkLastPoint() {
-  Point p1 = points[points.size() - 2];
-  Point p2 = points[points.size() - 1];
-  Point p3 = points[0];
+template <class T>
+void BasicPolygon<T>::checkLastPoint() {
+  if (points.size() < 3)
+    return;
+  BasicPoint<T> p1 = points[points.size() - 2];
+  BasicPoint<T> p2 = points[points.size() - 1];
+  BasicPoint<T> p3 = points[0];
   if (orientationTest(p1, p2, p3) == 0)
     points.pop_back();
 }
 
-void Polygon::read(istream& in) {
+template <class T>
+void BasicPolygon<T>::read(istream& in) {
   int pointsCount;
-  Point p;
+  BasicPoint<T> p;
   for (in >> pointsCount; pointsCount > 0; pointsCount--) {
     in >> p;
     addPoint(p);
   }
+  checkLastPoint();
 }
-istream& operator>>(istream& in, Polygon& polygon) {
+template <class T>
+istream& operator>>(istream& in, BasicPolygon<T>& polygon) {
   polygon.read(in);
   return in;
 }
 
 
-ll orientationTest(Point p1, Point p2, Point p3) {
-  return (
-    p3.getX() * p1.getY() + 
-    p1.getX() * p2.getY() - 
-    p3.getX() * p2.getY() - 
-    p1.getX() * p3.getY() + 
-    p2.getX() * p3.getY() - 
-    p2.getX() * p1.getY()
-  );
+/**
+ * @return True if a coordinate is in [-ORIENTATION_FAST_LIMIT, ORIENTATION_FAST_LIMIT), with a single comparison.
+ */
+inline bool fitsOrientationFastPath(ll coordinate) {
+  return (unsigned long long)coordinate + ORIENTATION_FAST_LIMIT < 2 * (unsigned long long)ORIENTATION_FAST_LIMIT;
+}
+
+/**
+ * @brief The exact sign of (x1 * y1 - x2 * y2), for any differences of two ll.
+ *
+ * The factors fit in 65 bits, so the products can reach 2^128 and would overflow a signed __int128:
+ * each product is kept as its sign and its unsigned 128-bit magnitude instead.
+ */
+int exactCrossSign(__int128 x1, __int128 y1, __int128 x2, __int128 y2) {
+  GEO_COUNT(EXACT_ORIENTATIONS, 1);
+  auto sign = [](__int128 value) { return (value > 0) - (value < 0); };
+  auto magnitude = [](__int128 value) { return (unsigned __int128)(value < 0 ? -value : value); };
+  int firstSign = sign(x1) * sign(y1), secondSign = sign(x2) * sign(y2);
+  if (firstSign != secondSign)
+    return firstSign > secondSign ? 1 : -1;
+  unsigned __int128 first = magnitude(x1) * magnitude(y1), second = magnitude(x2) * magnitude(y2);
+  return first == second ? 0 : (first > second ? firstSign : -firstSign);
+}
+
+/**
+ * @brief int32 coordinates: the differences fit in 33 bits, so the products only overflow 64 bits near the
+ * ends of the int32 range. The overflow flags of the 64-bit operations are the filter.
+ */
+template <>
+struct CoordinateTraits<int32_t> {
+  typedef ll Wide;
+
+  static Wide orientation(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3) {
+    ll dx2 = (ll)x2 - x1, dy3 = (ll)y3 - y1, dy2 = (ll)y2 - y1, dx3 = (ll)x3 - x1;
+    ll first, second, result;
+    if (!__builtin_mul_overflow(dx2, dy3, &first) && !__builtin_mul_overflow(dy2, dx3, &second) && !__builtin_sub_overflow(first, second, &result))
+      return result;
+    return exactCrossSign(dx2, dy3, dy2, dx3);
+  }
+};
+
+/**
+ * @brief ll coordinates: 64 bits when every coordinate fits the fast path, 128 bits otherwise.
+ */
+template <>
+struct CoordinateTraits<ll> {
+  typedef ll Wide;
+
+  static Wide orientation(ll x1, ll y1, ll x2, ll y2, ll x3, ll y3) {
+    if (fitsOrientationFastPath(x1) && fitsOrientationFastPath(y1) &&
+        fitsOrientationFastPath(x2) && fitsOrientationFastPath(y2) &&
+        fitsOrientationFastPath(x3) && fitsOrientationFastPath(y3))
+      return (x2 - x1) * (y3 - y1) - (y2 - y1) * (x3 - x1);
+
+    return exactCrossSign((__int128)x2 - x1, (__int128)y3 - y1, (__int128)y2 - y1, (__int128)x3 - x1);
+  }
+};
+
+/**
+ * @brief double coordinates: computed in long double, so the result is only as exact as the inputs allow.
+ */
+template <>
+struct CoordinateTraits<double> {
+  typedef long double Wide;
+
+  static Wide orientation(double x1, double y1, double x2, double y2, double x3, double y3) {
+    return ((Wide)x2 - x1) * ((Wide)y3 - y1) - ((Wide)y2 - y1) * ((Wide)x3 - x1);
+  }
+};
+
+template <class T>
+inline typename CoordinateTraits<T>::Wide orientationTest(BasicPoint<T> p1, BasicPoint<T> p2, BasicPoint<T> p3) {
+  GEO_COUNT(ORIENTATION_TESTS, 1);
+  return CoordinateTraits<T>::orientation(p1.getX(), p1.getY(), p2.getX(), p2.getY(), p3.getX(), p3.getY());
 }
 
-ll orientationTest(Line line, Point point) {
+template <class T>
+inline typename CoordinateTraits<T>::Wide orientationTest(BasicLine<T> line, BasicPoint<T> point) {
   return orientationTest(line.getStartPoint(), line.getEndPoint(), point);
 }
 
 
-#endif
\ No newline at end of file
+#endif
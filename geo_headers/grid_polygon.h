@@ -0,0 +1,227 @@
+#ifndef GRID_POLYGON_H
+#define GRID_POLYGON_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "geometric_basics.h"
+#include "point_location.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/**
+ * @brief A polygon prepared with a uniform grid over its bounding box.
+ *
+ * Every cell is classified once: entirely INSIDE, entirely OUTSIDE, or crossed by the boundary, in which case
+ * it keeps the edges touching it. A query in a classified cell is a single lookup. A query in a crossed cell
+ * only counts the edges its ray crosses until the next classified cell of its row, whose position is known.
+ *
+ * The number of cells trades memory for speed: more cells mean fewer crossed cells and shorter edge lists.
+ */
+class GridPolygon {
+private:
+  static constexpr unsigned char CROSSED = 3; /**< The state of a cell touched by the boundary, next to the PointPosition values. */
+
+  ll minX, minY, maxX, maxY;
+  ll cellWidth, cellHeight;
+  ll columns, rows;
+  vector<Line> edges;
+  vector<unsigned char> cellStates; /**< A PointPosition for the classified cells, CROSSED for the others, row after row. */
+  vector<int> cellStart; /**< The position in cellEdges where the edges of each cell start. */
+  vector<int> cellEdges; /**< The indexes of the edges touching each cell, cell after cell. */
+
+  ll getCellX(ll column) const { return minX + column * cellWidth; }
+  ll getCellY(ll row) const { return minY + row * cellHeight; }
+
+  /**
+   * @brief The x of an edge at a height, as an offset from minX rounded down or up, exact for any coordinates.
+   * @param start The lower end of the edge, which is not horizontal.
+   * @param end The upper end of the edge.
+   * @param y A height between the ends.
+   */
+  __int128 getEdgeOffset(Point start, Point end, ll y, bool roundUp) const;
+
+  /**
+   * @brief Calls a function for every cell an edge may touch; a few cells around it may be included too.
+   */
+  template <class Visitor>
+  void forEachCell(const Line& edge, Visitor visit) const;
+
+  /**
+   * @brief Finds the position of a point that is not on the boundary, from its cell and the cells on its right.
+   *
+   * The point is inside if the next classified cell of its row is inside, and the ray to it crosses the boundary
+   * an even number of times. Each crossing is counted in the one cell containing it.
+   */
+  PointPosition walkRow(Point point, ll column, ll row) const;
+public:
+  GridPolygon() {}
+
+  /**
+   * @param polygon The polygon to prepare.
+   * @param cellsCount The approximate number of cells; 0 uses 4 cells per vertex.
+   * @param pool The threads classifying the cells, or nullptr to classify them on the calling thread.
+   */
+  GridPolygon(const Polygon& polygon, size_t cellsCount = 0, ThreadPool* pool = nullptr);
+
+  /**
+   * @brief Builds the grid for a polygon, replacing any previous content.
+   */
+  void build(const Polygon& polygon, size_t cellsCount = 0, ThreadPool* pool = nullptr);
+
+  /**
+   * @brief Determines the position of a point with respect to the prepared polygon.
+   * @param point The point to be tested.
+   * @return The position of the point: INSIDE, OUTSIDE, or BOUNDARY.
+   */
+  PointPosition getPointPosition(Point point) const;
+
+  size_t getCellsCount() const { return cellStates.size(); }
+
+  /**
+   * @return The number of (cell, edge) pairs stored by the grid.
+   */
+  size_t getEntryCount() const { return cellEdges.size(); }
+};
+
+GridPolygon::GridPolygon(const Polygon& polygon, size_t cellsCount, ThreadPool* pool) {
+  build(polygon, cellsCount, pool);
+}
+
+__int128 GridPolygon::getEdgeOffset(Point start, Point end, ll y, bool roundUp) const {
+  // |deltaX| * rise is below 2^128, so the product and the division are exact in unsigned 128 bits
+  __int128 deltaX = (__int128)end.getX() - start.getX();
+  unsigned __int128 rise = (__int128)y - start.getY();
+  unsigned __int128 deltaY = (__int128)end.getY() - start.getY();
+  unsigned __int128 product = (unsigned __int128)(deltaX < 0 ? -deltaX : deltaX) * rise;
+  __int128 quotient = product / deltaY;
+  bool exact = product % deltaY == 0;
+  __int128 base = (__int128)start.getX() - minX;
+  if (deltaX >= 0)
+    return base + quotient + (roundUp && !exact ? 1 : 0);
+  return base - quotient - (!roundUp && !exact ? 1 : 0);
+}
+
+template <class Visitor>
+void GridPolygon::forEachCell(const Line& edge, Visitor visit) const {
+  Point start = edge.getStartPoint(), end = edge.getEndPoint();
+  if (start.getY() > end.getY())
+    swap(start, end);
+  ll firstRow = (start.getY() - minY) / cellHeight;
+  ll lastRow = (end.getY() - minY) / cellHeight;
+  for (ll row = firstRow; row <= lastRow; row++) {
+    // The x range of the edge inside the row, as exact offsets from minX, widened by one unit
+    __int128 low, high;
+    if (start.getY() == end.getY()) {
+      low = (__int128)min(start.getX(), end.getX()) - minX;
+      high = (__int128)max(start.getX(), end.getX()) - minX;
+    } else {
+      ll bottom = max(start.getY(), getCellY(row));
+      ll top = (ll)min<__int128>(end.getY(), (__int128)minY + (row + 1) * cellHeight);
+      low = min(getEdgeOffset(start, end, bottom, false), getEdgeOffset(start, end, top, false));
+      high = max(getEdgeOffset(start, end, bottom, true), getEdgeOffset(start, end, top, true));
+    }
+    ll firstColumn = low < 1 ? 0 : (ll)((low - 1) / cellWidth);
+    ll lastColumn = (ll)min<__int128>(columns - 1, (high + 1) / cellWidth);
+    for (ll column = firstColumn; column <= lastColumn; column++)
+      visit(row * columns + column);
+  }
+}
+
+void GridPolygon::build(const Polygon& polygon, size_t cellsCount, ThreadPool* pool) {
+  GEO_PHASE("prepare");
+  edges.clear();
+  int n = polygon.getSize();
+  for (int i = 0; i < n; i++)
+    edges.push_back(Line(polygon.getPoint(i), polygon.getPoint((i + 1) % n)));
+  if (cellsCount == 0)
+    cellsCount = 4 * max(n, 1);
+
+  minX = polygon.getLeftExtreme();
+  minY = polygon.getBottomExtreme();
+  maxX = polygon.getRightExtreme();
+  maxY = polygon.getTopExtreme();
+  ll width = maxX - minX + 1, height = maxY - minY + 1;
+  columns = max(1LL, min(width, (ll)llround(sqrt((double)cellsCount * width / height))));
+  rows = max(1LL, min(height, (ll)(cellsCount / columns)));
+  cellWidth = (width + columns - 1) / columns;
+  cellHeight = (height + rows - 1) / rows;
+
+  // Bucket the edges by cell, counting them first
+  size_t cellsTotal = columns * rows;
+  cellStart.assign(cellsTotal + 1, 0);
+  for (auto& edge : edges)
+    forEachCell(edge, [&](ll cell) { cellStart[cell + 1]++; });
+  for (size_t cell = 0; cell < cellsTotal; cell++)
+    cellStart[cell + 1] += cellStart[cell];
+  cellEdges.resize(cellStart[cellsTotal]);
+  vector<int> filled(cellStart.begin(), cellStart.end() - 1);
+  for (int i = 0; i < (int)edges.size(); i++)
+    forEachCell(edges[i], [&](ll cell) { cellEdges[filled[cell]++] = i; });
+
+  // Classify the cells right to left, so the walk from a cell always ends on an already classified one
+  cellStates.assign(cellsTotal, CROSSED);
+  auto classifyRows = [&](size_t firstRow, size_t lastRow) {
+    for (ll row = firstRow; row < (ll)lastRow; row++)
+      for (ll column = columns - 1; column >= 0; column--) {
+        ll cell = row * columns + column;
+        if (cellStart[cell] == cellStart[cell + 1])
+          cellStates[cell] = walkRow(Point(getCellX(column), getCellY(row)), column, row);
+      }
+  };
+  if (pool == nullptr)
+    classifyRows(0, rows);
+  else
+    pool->parallelFor(rows, 0, classifyRows);
+}
+
+PointPosition GridPolygon::walkRow(Point point, ll column, ll row) const {
+  long linesCrossed = 0;
+  PointPosition endPosition = OUTSIDE;
+  for (ll current = column; current < columns; current++) {
+    ll cell = row * columns + current;
+    if (current > column && cellStates[cell] != CROSSED) {
+      endPosition = (PointPosition)cellStates[cell];
+      break;
+    }
+
+    // Count the crossings in [left border, right border) of this cell, in (point, right border) for the first one
+    Point left(getCellX(current), point.getY());
+    Point right(getCellX(current + 1), point.getY());
+    GEO_COUNT(EDGES_SCANNED, cellStart[cell + 1] - cellStart[cell]);
+    for (int i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+      Point start = edges[cellEdges[i]].getStartPoint();
+      Point end = edges[cellEdges[i]].getEndPoint();
+      if ((start.getY() > point.getY()) == (end.getY() > point.getY()))
+        continue;
+      if (start.getY() > end.getY())
+        swap(start, end);
+      bool afterLeft = current == column ? orientationTest(start, end, point) > 0 : orientationTest(start, end, left) >= 0;
+      if (afterLeft && orientationTest(start, end, right) < 0)
+        linesCrossed++;
+    }
+  }
+
+  if (linesCrossed % 2 == 0) return endPosition;
+  else return endPosition == INSIDE ? OUTSIDE : INSIDE;
+}
+
+PointPosition GridPolygon::getPointPosition(Point point) const {
+  if (point.getX() < minX || point.getX() > maxX || point.getY() < minY || point.getY() > maxY)
+    return OUTSIDE;
+  ll column = (point.getX() - minX) / cellWidth;
+  ll row = (point.getY() - minY) / cellHeight;
+  ll cell = row * columns + column;
+  if (cellStates[cell] != CROSSED)
+    return (PointPosition)cellStates[cell];
+
+  // Any edge going through the point touches its cell
+  GEO_COUNT(EDGES_SCANNED, cellStart[cell + 1] - cellStart[cell]);
+  for (int i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+    if (pointOnSegment(point, edges[cellEdges[i]].getStartPoint(), edges[cellEdges[i]].getEndPoint()))
+      return BOUNDARY;
+  return walkRow(point, column, row);
+}
+
+#endif
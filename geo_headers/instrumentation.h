@@ -0,0 +1,227 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief The events counted on the hot paths when the tools are built with -DGEO_INSTRUMENT.
+ */
+enum InstrumentationCounter {
+  ORIENTATION_TESTS, /**< Calls of orientationTest. */
+  EXACT_ORIENTATIONS, /**< Orientation tests that left the 64-bit path for the exact 128-bit one. */
+  POINTS_CLASSIFIED, /**< Points given to a locator. */
+  EDGES_SCANNED, /**< Edges tested against a point by the ray casting, slab, grid and prepared locators, counted per
+                      scanned range, so a scan stopped on the boundary still counts its whole range. */
+  HULL_POPS, /**< Points popped from a monotone chain while building a hull. */
+  COUNTERS_COUNT
+};
+
+#ifdef GEO_INSTRUMENT
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Collects the counters and the phase times of the whole process, and reports them at exit.
+ *
+ * Every thread counts in its own threadCounters, without any synchronization, and adds them to the totals here
+ * when it ends, provided it was registered by a phase or by GEO_THREAD; the threads of the process are all joined
+ * before the static objects are destroyed, so the report, written by the destructor, sees every count.
+ */
+class Instrumentation {
+private:
+  mutex lock;
+  uint64_t totals[COUNTERS_COUNT];
+  vector<pair<string, double>> phases; /**< The milliseconds spent in every phase, in the order they first ran. */
+  chrono::steady_clock::time_point start;
+  string jsonPath;
+
+  Instrumentation();
+  void writeText(ostream& out, double wallMs);
+  void writeJson(ostream& out, double wallMs);
+public:
+  static const char* getCounterName(InstrumentationCounter counter);
+
+  /**
+   * @return The instance of the process, created on first use.
+   */
+  static Instrumentation& get();
+
+  void addCounters(const uint64_t* values);
+  void addPhase(const char* name, double milliseconds);
+
+  /**
+   * @param path The file receiving the report as JSON; empty to print it as text on the standard output.
+   */
+  void setJsonPath(const string& path);
+
+  ~Instrumentation();
+};
+
+/**
+ * @brief The counters of the running thread. Being trivially constructed, they are zeroed with the thread and
+ * reached without any initialization check, so a count is a single add that the compiler can keep in a register
+ * through a loop.
+ */
+inline thread_local uint64_t threadCounters[COUNTERS_COUNT];
+
+/**
+ * @brief The state of one thread that needs construction: its active phases, and the registration that adds
+ * threadCounters to the process totals when the thread ends.
+ */
+struct ThreadState {
+  vector<const char*> activePhases; /**< The phases running on this thread, so that a nested one is not counted twice. */
+
+  ThreadState() {
+    // Creating the instance first makes it outlive the counters of the main thread
+    Instrumentation::get();
+  }
+  ~ThreadState() { Instrumentation::get().addCounters(threadCounters); }
+
+  static ThreadState& get() {
+    static thread_local ThreadState state;
+    return state;
+  }
+};
+
+/**
+ * @brief Adds the wall time of a scope to a phase, unless the same phase already runs around it on this thread.
+ */
+class PhaseTimer {
+private:
+  const char* name;
+  bool nested;
+  chrono::steady_clock::time_point start;
+public:
+  PhaseTimer(const char* name);
+  ~PhaseTimer();
+};
+
+Instrumentation::Instrumentation() {
+  memset(totals, 0, sizeof(totals));
+  start = chrono::steady_clock::now();
+}
+
+const char* Instrumentation::getCounterName(InstrumentationCounter counter) {
+  static const char* names[] = { "orientation_tests", "exact_orientations", "points_classified", "edges_scanned", "hull_pops" };
+  return names[counter];
+}
+
+Instrumentation& Instrumentation::get() {
+  static Instrumentation instance;
+  return instance;
+}
+
+void Instrumentation::addCounters(const uint64_t* values) {
+  unique_lock<mutex> guard(lock);
+  for (int i = 0; i < COUNTERS_COUNT; i++)
+    totals[i] += values[i];
+}
+
+void Instrumentation::addPhase(const char* name, double milliseconds) {
+  unique_lock<mutex> guard(lock);
+  for (auto& phase : phases)
+    if (phase.first == name) {
+      phase.second += milliseconds;
+      return;
+    }
+  phases.push_back({ name, milliseconds });
+}
+
+void Instrumentation::setJsonPath(const string& path) {
+  unique_lock<mutex> guard(lock);
+  jsonPath = path;
+}
+
+void Instrumentation::writeText(ostream& out, double wallMs) {
+  out << "Instrumentation report\n";
+  out << "  wall time: " << wallMs << " ms\n";
+  for (auto& phase : phases)
+    out << "  phase " << phase.first << ": " << phase.second << " ms\n";
+  for (int i = 0; i < COUNTERS_COUNT; i++)
+    out << "  " << getCounterName((InstrumentationCounter)i) << ": " << totals[i] << "\n";
+  if (totals[POINTS_CLASSIFIED] > 0)
+    out << "  edges scanned per point: " << (double)totals[EDGES_SCANNED] / totals[POINTS_CLASSIFIED] << "\n";
+}
+
+void Instrumentation::writeJson(ostream& out, double wallMs) {
+  out << "{\"wall_ms\": " << wallMs << ", \"phases_ms\": {";
+  for (size_t i = 0; i < phases.size(); i++)
+    out << (i ? ", " : "") << "\"" << phases[i].first << "\": " << phases[i].second;
+  out << "}, \"counters\": {";
+  for (int i = 0; i < COUNTERS_COUNT; i++)
+    out << (i ? ", " : "") << "\"" << getCounterName((InstrumentationCounter)i) << "\": " << totals[i];
+  out << "}}\n";
+}
+
+Instrumentation::~Instrumentation() {
+  double wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  if (jsonPath.empty()) {
+    writeText(cout, wallMs);
+    return;
+  }
+  ofstream fout(jsonPath);
+  writeJson(fout, wallMs);
+}
+
+PhaseTimer::PhaseTimer(const char* name) : name(name) {
+  vector<const char*>& activePhases = ThreadState::get().activePhases;
+  nested = false;
+  for (const char* active : activePhases)
+    nested |= strcmp(active, name) == 0;
+  if (!nested)
+    activePhases.push_back(name);
+  start = chrono::steady_clock::now();
+}
+
+PhaseTimer::~PhaseTimer() {
+  if (nested)
+    return;
+  Instrumentation::get().addPhase(name, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+  ThreadState::get().activePhases.pop_back();
+}
+
+#define GEO_COUNT(counter, amount) (threadCounters[counter] += (amount))
+#define GEO_THREAD() ((void)ThreadState::get())
+#define GEO_PHASE_NAME(line) phaseTimer##line
+#define GEO_PHASE_AT(name, line) PhaseTimer GEO_PHASE_NAME(line)(name)
+#define GEO_PHASE(name) GEO_PHASE_AT(name, __LINE__)
+
+/**
+ * @brief Starts the wall clock of the report and sets where it goes.
+ * @param jsonPath The file receiving the report as JSON; empty to print it as text on the standard output.
+ */
+inline void setInstrumentationReport(const string& jsonPath) {
+  Instrumentation::get().setJsonPath(jsonPath);
+}
+
+#else
+
+/**
+ * @brief Counts an event; compiled out without -DGEO_INSTRUMENT.
+ */
+#define GEO_COUNT(counter, amount) ((void)0)
+
+/**
+ * @brief Adds the wall time of the enclosing scope to a named phase; compiled out without -DGEO_INSTRUMENT.
+ */
+#define GEO_PHASE(name) ((void)0)
+
+/**
+ * @brief Registers the running thread, so that its counts reach the report when it ends. A thread is registered
+ * by its first phase; the threads that may count outside of any phase call this once when they start.
+ */
+#define GEO_THREAD() ((void)0)
+
+inline void setInstrumentationReport(const string&) {}
+
+#endif
+
+#endif
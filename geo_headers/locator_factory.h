@@ -0,0 +1,97 @@
+#ifndef LOCATOR_FACTORY_H
+#define LOCATOR_FACTORY_H
+
+#include <string>
+#include <chrono>
+#include "geometric_basics.h"
+#include "point_location.h"
+#include "thread_pool.h"
+#include "ray_casting.h"
+#include "slab_index.h"
+#include "prepared_polygon.h"
+#include "convex_locator.h"
+#include "sweep_classifier.h"
+#include "grid_polygon.h"
+
+using namespace std;
+
+/**
+ * @brief The largest slab index auto builds, in (slab, edge) pairs (256 MB); the polygons needing more get the grid.
+ */
+const size_t AUTO_SLAB_MAX_ENTRIES = (size_t)1 << 26;
+
+/**
+ * @brief Builds a point locator by name, then hands a batch classifier over it to a function.
+ * @param name auto, convex, sweep, grid, ray, slab or prepared; auto is convex for convex polygons, slab otherwise,
+ * or grid when the slab index would hold more than AUTO_SLAB_MAX_ENTRIES pairs.
+ * @param gridCells The approximate number of cells of the grid locator, 0 for the default.
+ * @param buildMs Receives the time the locator took to build, or nullptr.
+ * @param body Called once with classify(points, count, positions), which classifies a batch of points of any
+ * coordinate type and may be called for any number of batches. The sweep answers the polygons that are not simple
+ * with the slab index, built by the first batch that finds it.
+ * @return False if the name is unknown, or if it is convex and the polygon is not.
+ */
+template <class Body>
+bool withNamedLocator(string name, const Polygon& polygon, ThreadPool& pool, size_t gridCells, double* buildMs, Body body) {
+  auto start = chrono::steady_clock::now();
+  auto built = [&]() {
+    if (buildMs != nullptr)
+      *buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  };
+
+  ConvexLocator convexLocator;
+  SlabIndex slabIndex;
+  bool slabBuilt = false;
+  if (name == "auto" || name == "convex") {
+    bool convex = convexLocator.build(polygon);
+    if (name == "convex" && !convex)
+      return false;
+    if (convex) {
+      name = "convex";
+      built();
+    } else {
+      // The slab index grows as N^2 for some polygons, where the grid stays linear
+      start = chrono::steady_clock::now();
+      slabBuilt = slabIndex.build(polygon, AUTO_SLAB_MAX_ENTRIES);
+      name = slabBuilt ? "slab" : "grid";
+    }
+  }
+
+  if (name == "convex") {
+    body([&](auto points, size_t count, PointPosition* positions) { classifyPoints(convexLocator, points, count, positions, pool); });
+  } else if (name == "sweep") {
+    SweepClassifier sweepClassifier(polygon);
+    bool simple = true;
+    built();
+    body([&](auto points, size_t count, PointPosition* positions) {
+      if (simple && sweepClassifier.classify(points, count, positions))
+        return;
+      if (simple) {
+        simple = false;
+        slabIndex.build(polygon);
+      }
+      classifyPoints(slabIndex, points, count, positions, pool);
+    });
+  } else if (name == "grid") {
+    GridPolygon gridPolygon(polygon, gridCells, &pool);
+    built();
+    body([&](auto points, size_t count, PointPosition* positions) { classifyPoints(gridPolygon, points, count, positions, pool); });
+  } else if (name == "ray") {
+    built();
+    body([&](auto points, size_t count, PointPosition* positions) { RayCasting::getPointPositions(points, count, polygon, positions, pool); });
+  } else if (name == "slab") {
+    if (!slabBuilt)
+      slabIndex.build(polygon);
+    built();
+    body([&](auto points, size_t count, PointPosition* positions) { classifyPoints(slabIndex, points, count, positions, pool); });
+  } else if (name == "prepared") {
+    PreparedPolygon preparedPolygon(polygon);
+    built();
+    body([&](auto points, size_t count, PointPosition* positions) { classifyPoints(preparedPolygon, points, count, positions, pool); });
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <vector>
+#include <string>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "geometric_basics.h"
+#include "instrumentation.h"
+
+using namespace std;
+
+/**
+ * @brief Text built in memory with to_chars, to be written to a file in a few large writes.
+ *
+ * Unlike an ostream, appending does not go through locales, sentries or virtual calls, and nothing is flushed
+ * until the owner decides to.
+ */
+class OutputBuffer {
+private:
+  vector<char> text;
+  size_t used;
+
+  /**
+   * @return Where the next bytes go, with room for at least the given number of them.
+   */
+  char* reserve(size_t bytes);
+public:
+  OutputBuffer() { used = 0; }
+
+  void append(const char* value, size_t length);
+  void append(const char* value) { append(value, strlen(value)); }
+  void append(char value) { *reserve(1) = value; used++; }
+
+  template <class T>
+  void appendInteger(T value);
+
+  /**
+   * @brief Appends a point the way operator<< writes it: "(x, y)".
+   */
+  template <class T>
+  void appendPoint(BasicPoint<T> point);
+
+  const char* getData() const { return text.data(); }
+  size_t getSize() const { return used; }
+
+  /**
+   * @brief Empties the text, keeping the memory for the next one.
+   */
+  void clear() { used = 0; }
+};
+
+/**
+ * @brief An output file written with plain write() calls, for text already built in memory.
+ */
+class FileWriter {
+private:
+  int descriptor;
+
+  FileWriter(const FileWriter&);
+  FileWriter& operator=(const FileWriter&);
+public:
+  /**
+   * @brief The size from which a buffer is worth writing, for callers that fill one in several steps.
+   */
+  static const size_t FLUSH_SIZE = 1 << 22;
+
+  /**
+   * @param path The path of the file, created or truncated.
+   */
+  FileWriter(const string& path);
+
+  bool isOpen() const { return descriptor >= 0; }
+
+  /**
+   * @brief Writes the whole text of a buffer and empties it.
+   * @return False if the file could not be written.
+   */
+  bool write(OutputBuffer& buffer);
+
+  ~FileWriter();
+};
+
+char* OutputBuffer::reserve(size_t bytes) {
+  if (used + bytes > text.size())
+    text.resize(max(2 * text.size(), used + bytes));
+  return text.data() + used;
+}
+
+void OutputBuffer::append(const char* value, size_t length) {
+  memcpy(reserve(length), value, length);
+  used += length;
+}
+
+template <class T>
+void OutputBuffer::appendInteger(T value) {
+  // 20 digits and a sign hold any 64-bit integer
+  char* begin = reserve(24);
+  used = to_chars(begin, begin + 24, value).ptr - text.data();
+}
+
+template <class T>
+void OutputBuffer::appendPoint(BasicPoint<T> point) {
+  append('(');
+  appendInteger(point.getX());
+  append(", ", 2);
+  appendInteger(point.getY());
+  append(')');
+}
+
+FileWriter::FileWriter(const string& path) {
+  descriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+bool FileWriter::write(OutputBuffer& buffer) {
+  GEO_PHASE("output");
+  const char* data = buffer.getData();
+  size_t left = buffer.getSize();
+  while (left > 0) {
+    ssize_t written = ::write(descriptor, data, left);
+    if (written < 0)
+      break;
+    data += written;
+    left -= written;
+  }
+  buffer.clear();
+  return left == 0;
+}
+
+FileWriter::~FileWriter() {
+  if (descriptor >= 0)
+    close(descriptor);
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef POINT_LOCATION_H
+#define POINT_LOCATION_H
+
+#include <vector>
+#include <algorithm>
+#include "geometric_basics.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+enum PointPosition { INSIDE, OUTSIDE, BOUNDARY };
+
+/**
+ * @return The name of a position, as written in the output files.
+ */
+inline const char* getPositionName(PointPosition position) {
+  static const char* names[] = { "INSIDE", "OUTSIDE", "BOUNDARY" };
+  return names[position];
+}
+
+/**
+ * @brief Checks if a point lies on the closed segment between two points.
+ * @param point The point to test.
+ * @param start The first endpoint of the segment.
+ * @param end The second endpoint of the segment.
+ * @return True if the point is collinear with the segment and between its endpoints.
+ */
+bool pointOnSegment(Point point, Point start, Point end);
+
+/**
+ * @brief Checks if the horizontal ray going right from a point crosses an edge.
+ *
+ * Uses the half-open rule: the edge counts only when exactly one of its endpoints is strictly above the ray,
+ * so a ray passing through a vertex is counted once when the polygon goes across it and zero or two times
+ * when it only touches it. Horizontal edges never count.
+ *
+ * @param point The origin of the ray.
+ * @param start The first endpoint of the edge.
+ * @param end The second endpoint of the edge.
+ * @return True if the ray crosses the edge strictly to the right of the point.
+ */
+bool edgeCrossesRay(Point point, Point start, Point end);
+
+/**
+ * @brief Answers the two boundary cases the half-open crossing rule cannot see on its own:
+ * a point equal to a polygon vertex, or a point lying on a horizontal edge.
+ */
+class BoundaryIndex {
+private:
+  vector<Point> vertices; /**< The polygon vertices, sorted. */
+  vector<Line> horizontalEdges; /**< The horizontal edges, left to right, sorted by y and then by x. */
+public:
+  BoundaryIndex() {}
+  BoundaryIndex(const Polygon& polygon);
+
+  /**
+   * @brief Collects the vertices and the horizontal edges of a polygon.
+   * @param polygon The polygon to index.
+   */
+  void build(const Polygon& polygon);
+
+  /**
+   * @param point The point to test.
+   * @return True if the point is a vertex or lies on a horizontal edge of the polygon.
+   */
+  bool contains(Point point) const;
+};
+
+/**
+ * @brief Classifies a batch of points against a prebuilt locator, splitting the batch between the threads of a pool.
+ * @param locator Any locator with a const getPointPosition(Point) method, shared by all the threads.
+ * @param points The points to classify, with any integer coordinate type; each one is widened to a Point when tested.
+ * @param count The number of points.
+ * @param positions The preallocated output, receiving the position of points[i] at index i.
+ * @param pool The threads to run on.
+ */
+template <class Locator, class T>
+void classifyPoints(const Locator& locator, const BasicPoint<T>* points, size_t count, PointPosition* positions, ThreadPool& pool) {
+  GEO_PHASE("classify");
+  pool.parallelFor(count, 0, [&](size_t begin, size_t end) {
+    GEO_COUNT(POINTS_CLASSIFIED, end - begin);
+    for (size_t i = begin; i < end; i++)
+      positions[i] = locator.getPointPosition(Point(points[i]));
+  });
+}
+
+bool pointOnSegment(Point point, Point start, Point end) {
+  if (orientationTest(start, end, point) != 0)
+    return false;
+  return min(start.getX(), end.getX()) <= point.getX() && point.getX() <= max(start.getX(), end.getX()) &&
+         min(start.getY(), end.getY()) <= point.getY() && point.getY() <= max(start.getY(), end.getY());
+}
+
+bool edgeCrossesRay(Point point, Point start, Point end) {
+  if ((start.getY() > point.getY()) == (end.getY() > point.getY()))
+    return false;
+  // Orient the edge upwards, then the crossing is on the right when the point is on the left of the edge
+  if (start.getY() > end.getY())
+    swap(start, end);
+  return orientationTest(start, end, point) > 0;
+}
+
+BoundaryIndex::BoundaryIndex(const Polygon& polygon) {
+  build(polygon);
+}
+
+void BoundaryIndex::build(const Polygon& polygon) {
+  vertices.clear();
+  horizontalEdges.clear();
+  int n = polygon.getSize();
+  for (int i = 0; i < n; i++) {
+    Point start = polygon.getPoint(i);
+    Point end = polygon.getPoint((i + 1) % n);
+    vertices.push_back(start);
+    if (start.getY() == end.getY()) {
+      if (end < start)
+        swap(start, end);
+      horizontalEdges.push_back(Line(start, end));
+    }
+  }
+  sort(vertices.begin(), vertices.end());
+  sort(horizontalEdges.begin(), horizontalEdges.end(), [](Line a, Line b) {
+    if (a.getStartPoint().getY() == b.getStartPoint().getY())
+      return a.getStartPoint().getX() < b.getStartPoint().getX();
+    return a.getStartPoint().getY() < b.getStartPoint().getY();
+  });
+}
+
+bool BoundaryIndex::contains(Point point) const {
+  if (binary_search(vertices.begin(), vertices.end(), point))
+    return true;
+
+  // Self-intersecting polygons may have overlapping horizontal edges, so check every edge on this row starting before the point
+  auto first = lower_bound(horizontalEdges.begin(), horizontalEdges.end(), point.getY(), [](Line edge, ll y) {
+    return edge.getStartPoint().getY() < y;
+  });
+  for (auto it = first; it != horizontalEdges.end(); ++it) {
+    Line edge = *it;
+    if (edge.getStartPoint().getY() != point.getY() || edge.getStartPoint().getX() > point.getX())
+      break;
+    if (point.getX() <= edge.getEndPoint().getX())
+      return true;
+  }
+  return false;
+}
+
+#endif
@@ -0,0 +1,653 @@
+#ifndef POINT_READER_H
+#define POINT_READER_H
+
+#include <vector>
+#include <string>
+#include <charconv>
+#include <cstring>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "geometric_basics.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/**
+ * @brief A read-only view of a whole file, memory mapped when possible.
+ *
+ * Files that cannot be mapped (pipes, the standard input given as "-") are read into memory instead.
+ */
+class MappedFile {
+private:
+  const char* data;
+  size_t size;
+  bool mapped;
+  bool opened;
+  vector<char> buffer; /**< The content of files that could not be mapped. */
+
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+public:
+  /**
+   * @param path The path of the file, or "-" for the standard input.
+   */
+  MappedFile(const string& path);
+
+  /**
+   * @return True if the file could be opened.
+   */
+  bool isOpen() const { return opened; }
+
+  const char* getData() const { return data; }
+  size_t getSize() const { return size; }
+
+  ~MappedFile();
+};
+
+/**
+ * @brief The integers of a file, parsed in pieces that keep them as int32 while they fit, and as ll otherwise.
+ *
+ * The points are copied out of the pieces straight into their final coordinate type, and every piece is freed
+ * once copied, so loading never holds the integers of the whole file at 8 bytes each next to the points.
+ */
+class ParsedIntegers {
+private:
+  struct Piece {
+    vector<int32_t> narrowValues;
+    vector<ll> wideValues;
+    bool wide = false;
+    size_t offset = 0; /**< The index of the first integer of the piece among the integers of the file. */
+
+    size_t size() const { return wide ? wideValues.size() : narrowValues.size(); }
+    ll get(size_t index) const { return wide ? wideValues[index] : narrowValues[index]; }
+    void add(ll value);
+    void free();
+  };
+  vector<Piece> pieces;
+  size_t count;
+
+  /**
+   * @return The piece holding the integer at an index.
+   */
+  size_t findPiece(size_t index) const;
+
+  friend class PointReader;
+public:
+  ParsedIntegers() { count = 0; }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  ll operator[](size_t index) const;
+
+  /**
+   * @return True if every integer in [first, first + valuesCount) fits in an int32.
+   */
+  bool fitsNarrow(size_t first, size_t valuesCount) const;
+
+  /**
+   * @brief Copies pairs of integers into points, then frees the pieces they were read from.
+   * @param first The index of the x-coordinate of the first point; nothing after the points is read afterwards.
+   * @param points The preallocated points.
+   * @param pool The threads to run on, or nullptr to copy on the calling thread.
+   */
+  template <class T>
+  void takePoints(size_t first, size_t pointsCount, BasicPoint<T>* points, ThreadPool* pool);
+};
+
+/**
+ * @brief Points stored with the narrowest coordinate type that holds them.
+ *
+ * The points are kept as int32 when every coordinate fits, which halves their memory and the bandwidth of every
+ * pass over them, and as ll otherwise. visit() hands the storage to generic code with its actual type.
+ */
+class PointArray {
+private:
+  vector<BasicPoint<int32_t>> narrowPoints;
+  vector<Point> widePoints;
+  bool narrow;
+
+  vector<BasicPoint<int32_t>>& getStorage(int32_t) { return narrowPoints; }
+  vector<Point>& getStorage(ll) { return widePoints; }
+public:
+  PointArray() { narrow = false; }
+
+  /**
+   * @brief Switches to a coordinate type, freeing the points of the other one.
+   * @param count The new number of points.
+   * @return The storage of the points, to be filled by the caller.
+   */
+  template <class T>
+  vector<BasicPoint<T>>& reset(size_t count);
+
+  /**
+   * @brief Replaces the points with pairs of parsed integers, choosing the narrowest type that holds all of them.
+   * @param values The parsed integers, whose pieces holding the points are freed.
+   * @param first The index of the x-coordinate of the first point.
+   * @param count The number of points.
+   * @param pool The threads to run on, or nullptr to copy on the calling thread.
+   */
+  void assign(ParsedIntegers& values, size_t first, size_t count, ThreadPool* pool);
+
+  /**
+   * @return True if the points are stored as int32.
+   */
+  bool isNarrow() const { return narrow; }
+
+  size_t size() const { return narrow ? narrowPoints.size() : widePoints.size(); }
+
+  /**
+   * @brief Calls a generic function with the storage of the points, a vector<BasicPoint<int32_t>> or a vector<Point>.
+   * @return What the function returns.
+   */
+  template <class Visitor>
+  auto visit(Visitor visitor) { return narrow ? visitor(narrowPoints) : visitor(widePoints); }
+};
+
+/**
+ * @brief Parses the whitespace separated integers of the point files straight into flat buffers.
+ */
+class PointReader {
+private:
+  PointReader();
+
+  /**
+   * @brief The size under which a file is parsed on a single thread.
+   */
+  static const size_t PARALLEL_THRESHOLD = 1 << 20;
+public:
+  static bool isWhitespace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+  /**
+   * @brief Parses all the integers of a piece of text.
+   * @param begin The start of the text.
+   * @param end The end of the text.
+   * @param values Receives the integers, appended in order.
+   * @return False if the text contains anything else than integers and whitespace.
+   */
+  static bool parseIntegers(const char* begin, const char* end, vector<ll>& values);
+
+  /**
+   * @brief Parses all the integers of a piece of text, calling a function with each of them in order.
+   * @return False if the text contains anything else than integers and whitespace.
+   */
+  template <class Store>
+  static bool forEachInteger(const char* begin, const char* end, Store store);
+
+  /**
+   * @brief Parses all the integers of a file, splitting it at whitespace between the threads of a pool.
+   * @param file The file to parse.
+   * @param values Receives the integers, in file order.
+   * @param pool The threads to run on, or nullptr to parse on the calling thread.
+   * @return False if the file contains anything else than integers and whitespace.
+   */
+  static bool parseIntegers(const MappedFile& file, ParsedIntegers& values, ThreadPool* pool);
+
+  /**
+   * @brief Reads a convex hull input: one point per line.
+   * @param points Receives the points: a vector<Point>, or a PointArray to store them with the narrowest coordinate type.
+   * @return False if the file is not made of coordinate pairs.
+   */
+  template <class Points>
+  static bool readPoints(const MappedFile& file, Points& points, ThreadPool* pool);
+
+  /**
+   * @brief Reads a ray casting input: the polygon points count and points, then the query points count and points.
+   * @param points Receives the query points, like in readPoints().
+   * @return False if the file does not follow this format.
+   */
+  template <class Points>
+  static bool readPolygonAndPoints(const MappedFile& file, Polygon& polygon, Points& points, ThreadPool* pool);
+
+  /**
+   * @brief Reads a zones input: the zones count, then the points count and points of every zone, then the query points count and points.
+   * @param points Receives the query points, like in readPoints().
+   * @return False if the file does not follow this format.
+   */
+  template <class Points>
+  static bool readZonesAndPoints(const MappedFile& file, vector<Polygon>& zones, Points& points, ThreadPool* pool);
+
+  /**
+   * @brief Fills points from pairs of parsed integers, freeing the pieces they were read from.
+   */
+  static void assignPoints(ParsedIntegers& values, size_t first, size_t count, vector<Point>& points, ThreadPool* pool);
+  static void assignPoints(ParsedIntegers& values, size_t first, size_t count, PointArray& points, ThreadPool* pool) { points.assign(values, first, count, pool); }
+};
+
+/**
+ * @brief Reads the points of a text file one chunk at a time, for inputs that do not fit in memory.
+ *
+ * The file is read in blocks with plain read() calls, so it works on pipes and the standard input too,
+ * and the memory used does not depend on the file size.
+ */
+class PointStream {
+private:
+  int descriptor;
+  bool opened;
+  bool ended; /**< True once the end of the input was reached. */
+  bool failed; /**< True if the input could not be read or is not made of coordinate pairs. */
+  vector<char> buffer;
+  size_t pending; /**< The number of bytes at the start of the buffer that were cut by the end of the previous block. */
+  vector<ll> values; /**< The parsed integers of the last block. */
+  size_t consumed; /**< The number of integers of values already returned. */
+
+  PointStream(const PointStream&);
+  PointStream& operator=(const PointStream&);
+
+  /**
+   * @brief Reads and parses the next block, appending its integers to values.
+   * @return False at the end of the input or after an error.
+   */
+  bool readBlock();
+public:
+  /**
+   * @brief The number of bytes read at once.
+   */
+  static const size_t BLOCK_SIZE = 1 << 20;
+
+  /**
+   * @param path The path of the file, or "-" for the standard input.
+   */
+  PointStream(const string& path);
+
+  /**
+   * @return True if the file could be opened.
+   */
+  bool isOpen() const { return opened; }
+
+  /**
+   * @return True if reading stopped because of a read error or an invalid input.
+   */
+  bool hasFailed() const { return failed; }
+
+  /**
+   * @brief Reads the next integer of the file, for the counts and polygons that come before the points.
+   * @return False if no integer is left, at the end of the input or after an error.
+   */
+  bool readInteger(ll& value);
+
+  /**
+   * @brief Reads a polygon in the ray casting format: its points count, then its points.
+   * @param polygon Receives the points, appended to its content.
+   * @return False if the count is negative or the points are cut.
+   */
+  bool readPolygon(Polygon& polygon);
+
+  /**
+   * @brief Reads the next points of the file.
+   * @param points Receives the points, replacing its content.
+   * @param maxPoints Reading stops at the first block boundary after this many points.
+   * @return False if no point is left, at the end of the input or after an error.
+   */
+  bool readChunk(vector<Point>& points, size_t maxPoints);
+
+  ~PointStream();
+};
+
+MappedFile::MappedFile(const string& path) {
+  data = nullptr;
+  size = 0;
+  mapped = false;
+  opened = false;
+
+  int descriptor = path == "-" ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+  if (descriptor < 0)
+    return;
+  opened = true;
+
+  struct stat status;
+  if (fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+    void* address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (address != MAP_FAILED) {
+      madvise(address, status.st_size, MADV_SEQUENTIAL);
+      data = (const char*)address;
+      size = status.st_size;
+      mapped = true;
+    }
+  }
+
+  if (!mapped) {
+    char chunk[1 << 16];
+    ssize_t count;
+    while ((count = read(descriptor, chunk, sizeof(chunk))) > 0)
+      buffer.insert(buffer.end(), chunk, chunk + count);
+    data = buffer.data();
+    size = buffer.size();
+  }
+
+  if (descriptor != STDIN_FILENO)
+    close(descriptor);
+}
+
+MappedFile::~MappedFile() {
+  if (mapped)
+    munmap((void*)data, size);
+}
+
+PointStream::PointStream(const string& path) {
+  descriptor = path == "-" ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+  opened = descriptor >= 0;
+  ended = !opened;
+  failed = false;
+  pending = 0;
+  consumed = 0;
+}
+
+PointStream::~PointStream() {
+  if (opened && descriptor != STDIN_FILENO)
+    close(descriptor);
+}
+
+bool PointStream::readBlock() {
+  GEO_PHASE("parse");
+  if (ended || failed)
+    return false;
+  values.erase(values.begin(), values.begin() + consumed);
+  consumed = 0;
+  buffer.resize(pending + BLOCK_SIZE);
+  ssize_t count = read(descriptor, buffer.data() + pending, BLOCK_SIZE);
+  if (count < 0) {
+    failed = true;
+    return false;
+  }
+  ended = count == 0;
+
+  // Only parse up to the last whitespace, the number after it may continue in the next block
+  const char* begin = buffer.data();
+  const char* end = begin + pending + count;
+  const char* parsedEnd = end;
+  if (!ended)
+    while (parsedEnd > begin && !PointReader::isWhitespace(*(parsedEnd - 1)))
+      parsedEnd--;
+  if (!PointReader::parseIntegers(begin, parsedEnd, values)) {
+    failed = true;
+    return false;
+  }
+
+  pending = end - parsedEnd;
+  if (pending > BLOCK_SIZE) {
+    // No number is that long
+    failed = true;
+    return false;
+  }
+  memmove(buffer.data(), parsedEnd, pending);
+  return true;
+}
+
+bool PointStream::readInteger(ll& value) {
+  while (consumed == values.size())
+    if (!readBlock())
+      return false;
+  value = values[consumed++];
+  return true;
+}
+
+bool PointStream::readPolygon(Polygon& polygon) {
+  ll polygonSize = -1;
+  if (!readInteger(polygonSize) || polygonSize < 0)
+    return false;
+  for (ll i = 0; i < polygonSize; i++) {
+    ll x, y;
+    if (!readInteger(x) || !readInteger(y))
+      return false;
+    Point point(x, y);
+    polygon.addPoint(point);
+  }
+  polygon.checkLastPoint();
+  return true;
+}
+
+bool PointStream::readChunk(vector<Point>& points, size_t maxPoints) {
+  points.clear();
+  while (true) {
+    size_t pairsCount = (values.size() - consumed) / 2;
+    for (size_t i = 0; i < pairsCount; i++)
+      points.push_back(Point(values[consumed + 2 * i], values[consumed + 2 * i + 1]));
+    consumed += 2 * pairsCount;
+    if (points.size() >= maxPoints || !readBlock())
+      break;
+  }
+  if (ended && consumed < values.size())
+    failed = true;
+  return !points.empty();
+}
+
+void ParsedIntegers::Piece::add(ll value) {
+  if (!wide && value == (int32_t)value) {
+    narrowValues.push_back(value);
+    return;
+  }
+  if (!wide) {
+    // The first value that does not fit widens the whole piece
+    wideValues.reserve(narrowValues.capacity());
+    wideValues.assign(narrowValues.begin(), narrowValues.end());
+    vector<int32_t>().swap(narrowValues);
+    wide = true;
+  }
+  wideValues.push_back(value);
+}
+
+void ParsedIntegers::Piece::free() {
+  vector<int32_t>().swap(narrowValues);
+  vector<ll>().swap(wideValues);
+}
+
+size_t ParsedIntegers::findPiece(size_t index) const {
+  size_t left = 0, right = pieces.size() - 1;
+  while (left < right) {
+    size_t middle = (left + right + 1) / 2;
+    if (pieces[middle].offset <= index)
+      left = middle;
+    else
+      right = middle - 1;
+  }
+  return left;
+}
+
+ll ParsedIntegers::operator[](size_t index) const {
+  const Piece& piece = pieces[findPiece(index)];
+  return piece.get(index - piece.offset);
+}
+
+bool ParsedIntegers::fitsNarrow(size_t first, size_t valuesCount) const {
+  if (valuesCount == 0)
+    return true;
+  for (size_t i = findPiece(first); i < pieces.size() && pieces[i].offset < first + valuesCount; i++) {
+    if (!pieces[i].wide)
+      continue;
+    // A wide piece may still hold only narrow values in the range, its wide ones being before or after it
+    size_t begin = max(first, pieces[i].offset) - pieces[i].offset;
+    size_t end = min(first + valuesCount, pieces[i].offset + pieces[i].size()) - pieces[i].offset;
+    for (size_t j = begin; j < end; j++)
+      if (pieces[i].wideValues[j] != (int32_t)pieces[i].wideValues[j])
+        return false;
+  }
+  return true;
+}
+
+template <class T>
+void ParsedIntegers::takePoints(size_t first, size_t pointsCount, BasicPoint<T>* points, ThreadPool* pool) {
+  size_t last = first + 2 * pointsCount;
+  size_t firstPiece = pointsCount == 0 ? pieces.size() : findPiece(first);
+  // Every piece sets the coordinates it holds; a point cut between two pieces gets its x and y from each
+  auto body = [&](size_t begin, size_t end) {
+    for (size_t i = firstPiece + begin; i < firstPiece + end; i++) {
+      Piece& piece = pieces[i];
+      size_t from = max(first, piece.offset), to = min(last, piece.offset + piece.size());
+      for (size_t index = from; index < to; index++) {
+        T value = (T)piece.get(index - piece.offset);
+        if ((index - first) % 2 == 0)
+          points[(index - first) / 2].setX(value);
+        else
+          points[(index - first) / 2].setY(value);
+      }
+      piece.free();
+    }
+  };
+  size_t piecesCount = 0;
+  while (firstPiece + piecesCount < pieces.size() && pieces[firstPiece + piecesCount].offset < last)
+    piecesCount++;
+  if (pool == nullptr)
+    body(0, piecesCount);
+  else
+    pool->parallelFor(piecesCount, 1, body);
+}
+
+template <class Store>
+bool PointReader::forEachInteger(const char* begin, const char* end, Store store) {
+  const char* current = begin;
+  while (true) {
+    while (current < end && isWhitespace(*current))
+      current++;
+    if (current == end)
+      return true;
+
+    ll value;
+    // from_chars does not accept a leading plus sign, the stream extraction does
+    if (*current == '+' && current + 1 < end && *(current + 1) != '-')
+      current++;
+    from_chars_result result = from_chars(current, end, value);
+    if (result.ec != errc())
+      return false;
+    store(value);
+    current = result.ptr;
+  }
+}
+
+bool PointReader::parseIntegers(const char* begin, const char* end, vector<ll>& values) {
+  return forEachInteger(begin, end, [&](ll value) { values.push_back(value); });
+}
+
+bool PointReader::parseIntegers(const MappedFile& file, ParsedIntegers& values, ThreadPool* pool) {
+  GEO_PHASE("parse");
+  const char* begin = file.getData();
+  const char* end = begin + file.getSize();
+  bool parallel = pool != nullptr && pool->getThreadsCount() > 1 && file.getSize() >= PARALLEL_THRESHOLD;
+
+  // Cut the file in pieces ending right after a whitespace, so that no number is split
+  int piecesCount = parallel ? pool->getThreadsCount() * 4 : 1;
+  vector<const char*> cuts(piecesCount + 1, end);
+  cuts[0] = begin;
+  for (int i = 1; i < piecesCount; i++) {
+    const char* cut = max(cuts[i - 1], begin + file.getSize() / piecesCount * i);
+    while (cut < end && !isWhitespace(*cut))
+      cut++;
+    cuts[i] = cut;
+  }
+
+  values.pieces.assign(piecesCount, ParsedIntegers::Piece());
+  vector<char> valid(piecesCount, true);
+  auto parsePieces = [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      ParsedIntegers::Piece& piece = values.pieces[i];
+      piece.narrowValues.reserve((cuts[i + 1] - cuts[i]) / 8);
+      valid[i] = forEachInteger(cuts[i], cuts[i + 1], [&](ll value) { piece.add(value); });
+    }
+  };
+  if (parallel)
+    pool->parallelFor(piecesCount, 1, parsePieces);
+  else
+    parsePieces(0, piecesCount);
+
+  values.count = 0;
+  for (int i = 0; i < piecesCount; i++) {
+    if (!valid[i])
+      return false;
+    values.pieces[i].offset = values.count;
+    values.count += values.pieces[i].size();
+  }
+  return true;
+}
+
+template <class T>
+vector<BasicPoint<T>>& PointArray::reset(size_t count) {
+  narrow = is_same<T, int32_t>::value;
+  vector<BasicPoint<int32_t>>().swap(narrowPoints);
+  vector<Point>().swap(widePoints);
+  vector<BasicPoint<T>>& storage = getStorage(T());
+  storage.resize(count);
+  return storage;
+}
+
+void PointArray::assign(ParsedIntegers& values, size_t first, size_t count, ThreadPool* pool) {
+  if (values.fitsNarrow(first, 2 * count))
+    values.takePoints(first, count, reset<int32_t>(count).data(), pool);
+  else
+    values.takePoints(first, count, reset<ll>(count).data(), pool);
+}
+
+void PointReader::assignPoints(ParsedIntegers& values, size_t first, size_t count, vector<Point>& points, ThreadPool* pool) {
+  points.resize(count);
+  values.takePoints(first, count, points.data(), pool);
+}
+
+template <class Points>
+bool PointReader::readPoints(const MappedFile& file, Points& points, ThreadPool* pool) {
+  ParsedIntegers values;
+  if (!parseIntegers(file, values, pool) || values.size() % 2 != 0)
+    return false;
+  assignPoints(values, 0, values.size() / 2, points, pool);
+  return true;
+}
+
+template <class Points>
+bool PointReader::readPolygonAndPoints(const MappedFile& file, Polygon& polygon, Points& points, ThreadPool* pool) {
+  ParsedIntegers values;
+  if (!parseIntegers(file, values, pool) || values.empty())
+    return false;
+
+  // The counts are compared by dividing the values left, since doubling a huge count would overflow
+  ll polygonSize = values[0];
+  if (values.size() < 2 || polygonSize < 0 || polygonSize > (ll)((values.size() - 2) / 2))
+    return false;
+  for (ll i = 0; i < polygonSize; i++) {
+    Point point(values[1 + 2 * i], values[2 + 2 * i]);
+    polygon.addPoint(point);
+  }
+  polygon.checkLastPoint();
+
+  size_t position = 1 + 2 * polygonSize;
+  ll pointsCount = values[position++];
+  if (pointsCount < 0 || pointsCount > (ll)((values.size() - position) / 2))
+    return false;
+  assignPoints(values, position, pointsCount, points, pool);
+  return true;
+}
+
+template <class Points>
+bool PointReader::readZonesAndPoints(const MappedFile& file, vector<Polygon>& zones, Points& points, ThreadPool* pool) {
+  ParsedIntegers values;
+  if (!parseIntegers(file, values, pool) || values.empty())
+    return false;
+
+  ll zonesCount = values[0];
+  size_t position = 1;
+  if (zonesCount < 0 || zonesCount > (ll)values.size())
+    return false;
+  zones.assign(zonesCount, Polygon());
+  for (ll zone = 0; zone < zonesCount; zone++) {
+    if (position >= values.size())
+      return false;
+    ll polygonSize = values[position++];
+    if (polygonSize < 0 || polygonSize > (ll)((values.size() - position) / 2))
+      return false;
+    for (ll i = 0; i < polygonSize; i++) {
+      Point point(values[position + 2 * i], values[position + 2 * i + 1]);
+      zones[zone].addPoint(point);
+    }
+    zones[zone].checkLastPoint();
+    position += 2 * polygonSize;
+  }
+
+  if (position >= values.size())
+    return false;
+  ll pointsCount = values[position++];
+  if (pointsCount < 0 || pointsCount > (ll)((values.size() - position) / 2))
+    return false;
+  assignPoints(values, position, pointsCount, points, pool);
+  return true;
+}
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef POSITION_CACHE_H
+#define POSITION_CACHE_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "geometric_basics.h"
+#include "thread_pool.h"
+#include "point_location.h"
+
+using namespace std;
+
+/**
+ * @brief Remembers the position of the points already classified, so that repeated query points skip the locator.
+ *
+ * The entries live in one flat array with open addressing and linear probing, so a lookup hashes the point once
+ * and usually reads a single cache line, without the allocations and pointer chasing of a node-based map.
+ * The cache holds a fixed number of points; when a batch brings more new points than there is room left,
+ * it starts over empty, which keeps the memory bounded for endless streams. The repeats inside a batch are
+ * classified once even when its new points do not fit in the empty table.
+ */
+class PositionCache {
+private:
+  struct Entry {
+    Point point;
+    size_t value; /**< EMPTY, the position of the point, or while a batch is classified, its index among the new points. */
+  };
+  static const size_t EMPTY = SIZE_MAX;
+
+  vector<Entry> entries;
+  size_t mask;
+  size_t maxSize; /**< The number of points kept at most, half the entries so that probes stay short. */
+  size_t size;
+  size_t hits;
+  size_t misses;
+
+  size_t getSlot(Point point) const;
+  size_t find(Point point) const;
+public:
+  /**
+   * @param capacity The number of points kept at most.
+   */
+  PositionCache(size_t capacity);
+
+  /**
+   * @brief Classifies a batch of points, answering the cached ones directly and passing each distinct new point
+   * to the locator once.
+   * @param points The points to classify, with any integer coordinate type.
+   * @param count The number of points.
+   * @param positions The preallocated output, receiving the position of points[i] at index i.
+   * @param locate Called as locate(points, count, positions) with the distinct points missing from the cache.
+   * @param pool The threads that look up the points.
+   */
+  template <class T, class Locate>
+  void classify(const BasicPoint<T>* points, size_t count, PointPosition* positions, Locate locate, ThreadPool& pool);
+
+  /**
+   * @return The number of points answered from the cache, including repeats inside a batch.
+   */
+  size_t getHits() const { return hits; }
+
+  /**
+   * @return The number of points passed to the locator.
+   */
+  size_t getMisses() const { return misses; }
+
+  /**
+   * @brief Forgets every point, keeping the counters.
+   */
+  void clear();
+};
+
+/**
+ * @brief Classifies every distinct point of a batch once: the points are sorted with their indexes, the locator
+ * gets one copy of each, and the positions are scattered back in input order.
+ * @param points The points to classify, with any integer coordinate type.
+ * @param count The number of points.
+ * @param positions The preallocated output, receiving the position of points[i] at index i.
+ * @param locate Called once as locate(points, count, positions) with the distinct points, in sorted order.
+ * @param pool The threads that sort and scatter.
+ * @return The number of distinct points.
+ */
+template <class T, class Locate>
+size_t classifyDistinct(const BasicPoint<T>* points, size_t count, PointPosition* positions, Locate locate, ThreadPool& pool);
+
+PositionCache::PositionCache(size_t capacity) {
+  size_t slots = 2;
+  while (slots < 2 * capacity)
+    slots *= 2;
+  entries.assign(slots, Entry{ Point(), EMPTY });
+  mask = slots - 1;
+  maxSize = slots / 2;
+  size = 0;
+  hits = 0;
+  misses = 0;
+}
+
+size_t PositionCache::getSlot(Point point) const {
+  // Multiplying by odd constants spreads nearby coordinates over the whole table
+  uint64_t hash = (uint64_t)point.getX() * 0x9E3779B97F4A7C15ULL ^ (uint64_t)point.getY() * 0xC2B2AE3D27D4EB4FULL;
+  return (hash ^ hash >> 32) & mask;
+}
+
+size_t PositionCache::find(Point point) const {
+  size_t slot = getSlot(point);
+  while (entries[slot].value != EMPTY && !(entries[slot].point == point))
+    slot = (slot + 1) & mask;
+  return slot;
+}
+
+template <class T, class Locate>
+void PositionCache::classify(const BasicPoint<T>* points, size_t count, PointPosition* positions, Locate locate, ThreadPool& pool) {
+  // The lookups only read the table, so they run in parallel; the misses are marked with EMPTY
+  vector<size_t> found(count);
+  pool.parallelFor(count, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      found[i] = entries[find(Point(points[i]))].value;
+  });
+
+  vector<size_t> missed;
+  for (size_t i = 0; i < count; i++)
+    if (found[i] == EMPTY)
+      missed.push_back(i);
+  if (size + missed.size() > maxSize)
+    clear();
+
+  if (missed.size() > maxSize) {
+    // Even the empty table cannot take every miss: they are deduplicated on their own, and only the first
+    // distinct points that fit are kept
+    vector<BasicPoint<T>> missedPoints(missed.size());
+    vector<PointPosition> missedPositions(missed.size());
+    for (size_t k = 0; k < missed.size(); k++)
+      missedPoints[k] = points[missed[k]];
+    size_t locatedCount = classifyDistinct(missedPoints.data(), missedPoints.size(), missedPositions.data(),
+      [&](const BasicPoint<T>* distinct, size_t distinctCount, PointPosition* distinctPositions) {
+        locate(distinct, distinctCount, distinctPositions);
+        for (size_t k = 0; k < distinctCount && size < maxSize; k++) {
+          entries[find(Point(distinct[k]))] = Entry{ Point(distinct[k]), (size_t)distinctPositions[k] };
+          size++;
+        }
+      }, pool);
+    hits += count - locatedCount;
+    misses += locatedCount;
+    for (size_t i = 0; i < count; i++)
+      if (found[i] != EMPTY)
+        positions[i] = (PointPosition)found[i];
+    for (size_t k = 0; k < missed.size(); k++)
+      positions[missed[k]] = missedPositions[k];
+    return;
+  }
+
+  // Every distinct new point gets an entry holding its index among the new points until it is classified
+  vector<BasicPoint<T>> newPoints;
+  vector<size_t> newSlots, missedIndex(missed.size());
+  for (size_t k = 0; k < missed.size(); k++) {
+    Point point(points[missed[k]]);
+    size_t slot = find(point);
+    if (entries[slot].value == EMPTY) {
+      entries[slot] = Entry{ point, newPoints.size() };
+      size++;
+      missedIndex[k] = newPoints.size();
+      newPoints.push_back(points[missed[k]]);
+      newSlots.push_back(slot);
+    } else {
+      missedIndex[k] = entries[slot].value;
+    }
+  }
+  hits += count - newPoints.size();
+  misses += newPoints.size();
+
+  vector<PointPosition> newPositions(newPoints.size());
+  if (!newPoints.empty())
+    locate(newPoints.data(), newPoints.size(), newPositions.data());
+  for (size_t i = 0; i < newSlots.size(); i++)
+    entries[newSlots[i]].value = newPositions[i];
+
+  pool.parallelFor(count, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      if (found[i] != EMPTY)
+        positions[i] = (PointPosition)found[i];
+  });
+  for (size_t k = 0; k < missed.size(); k++)
+    positions[missed[k]] = newPositions[missedIndex[k]];
+}
+
+void PositionCache::clear() {
+  fill(entries.begin(), entries.end(), Entry{ Point(), EMPTY });
+  size = 0;
+}
+
+template <class T, class Locate>
+size_t classifyDistinct(const BasicPoint<T>* points, size_t count, PointPosition* positions, Locate locate, ThreadPool& pool) {
+  struct Query {
+    BasicPoint<T> point;
+    size_t index;
+    bool operator<(const Query& other) const { return point < other.point; }
+  };
+  vector<Query> queries(count);
+  pool.parallelFor(count, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      queries[i] = Query{ points[i], i };
+  });
+
+  // The chunks are sorted on their own threads, then merged by pairs until one run is left
+  size_t chunksCount = max<size_t>(1, min<size_t>(pool.getThreadsCount() * 4, count / 4096));
+  vector<size_t> bounds(chunksCount + 1);
+  for (size_t i = 0; i <= chunksCount; i++)
+    bounds[i] = count / chunksCount * i;
+  bounds[chunksCount] = count;
+  pool.parallelFor(chunksCount, 1, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++)
+      sort(queries.begin() + bounds[i], queries.begin() + bounds[i + 1]);
+  });
+  for (size_t width = 1; width < chunksCount; width *= 2) {
+    size_t pairsCount = (chunksCount + 2 * width - 1) / (2 * width);
+    pool.parallelFor(pairsCount, 1, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; i++) {
+        size_t begin = 2 * width * i;
+        size_t middle = min(begin + width, chunksCount);
+        size_t end = min(begin + 2 * width, chunksCount);
+        inplace_merge(queries.begin() + bounds[begin], queries.begin() + bounds[middle], queries.begin() + bounds[end]);
+      }
+    });
+  }
+
+  vector<BasicPoint<T>> distinct;
+  vector<size_t> distinctIndex(count);
+  for (size_t i = 0; i < count; i++) {
+    if (i == 0 || !(queries[i].point == queries[i - 1].point))
+      distinct.push_back(queries[i].point);
+    distinctIndex[i] = distinct.size() - 1;
+  }
+  vector<PointPosition> distinctPositions(distinct.size());
+  if (!distinct.empty())
+    locate(distinct.data(), distinct.size(), distinctPositions.data());
+  pool.parallelFor(count, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      positions[queries[i].index] = distinctPositions[distinctIndex[i]];
+  });
+  return distinct.size();
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef QUERY_CLIENT_H
+#define QUERY_CLIENT_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "geometric_basics.h"
+#include "point_location.h"
+#include "query_protocol.h"
+
+using namespace std;
+
+/**
+ * @brief A blocking connection to a query server, sending one request at a time.
+ */
+class QueryClient {
+private:
+  int descriptor;
+  vector<char> request; /**< The last request, kept to reuse its memory. */
+
+  QueryClient(const QueryClient&);
+  QueryClient& operator=(const QueryClient&);
+public:
+  /**
+   * @param path The path of the server socket.
+   */
+  QueryClient(const string& path);
+
+  bool isConnected() const { return descriptor >= 0; }
+
+  /**
+   * @brief Classifies points against a polygon of the server and waits for the answer.
+   * @param polygon The index of the polygon on the server.
+   * @param points The points, MAX_QUERY_POINTS at most.
+   * @param count The number of points.
+   * @param positions Receives the position of every point.
+   * @return The status of the request, or QUERY_FAILED after closing the connection if it failed.
+   */
+  QueryStatus classify(uint32_t polygon, const Point* points, size_t count, vector<PointPosition>& positions);
+
+  ~QueryClient();
+};
+
+/**
+ * @brief Prints the median and tail latencies of requests, and the throughput they add up to.
+ * @param latencies The time every request took, in microseconds; sorted by the call.
+ * @param queriesCount The number of points classified by all the requests.
+ * @param seconds The wall time of the whole run.
+ */
+void printLatencies(vector<double>& latencies, size_t queriesCount, double seconds);
+
+QueryClient::QueryClient(const string& path) {
+  sockaddr_un address;
+  descriptor = -1;
+  if (!getSocketAddress(path, address))
+    return;
+  descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (descriptor >= 0 && connect(descriptor, (sockaddr*)&address, sizeof(address)) != 0) {
+    close(descriptor);
+    descriptor = -1;
+  }
+}
+
+QueryStatus QueryClient::classify(uint32_t polygon, const Point* points, size_t count, vector<PointPosition>& positions) {
+  QueryRequestHeader header = { { 'G', 'E', 'O', 'Q' }, polygon, (uint32_t)count, 0 };
+  request.resize(sizeof(header) + count * sizeof(Point));
+  memcpy(request.data(), &header, sizeof(header));
+  memcpy(request.data() + sizeof(header), points, count * sizeof(Point));
+
+  QueryResponseHeader response;
+  vector<unsigned char> bytes;
+  bool valid = descriptor >= 0 && count <= MAX_QUERY_POINTS && sendAll(descriptor, request.data(), request.size()) &&
+               receiveAll(descriptor, &response, sizeof(response));
+  if (valid && response.status == QUERY_OK) {
+    bytes.resize(response.count);
+    valid = response.count == count && receiveAll(descriptor, bytes.data(), bytes.size());
+  }
+  if (!valid) {
+    if (descriptor >= 0)
+      close(descriptor);
+    descriptor = -1;
+    return QUERY_FAILED;
+  }
+
+  positions.resize(bytes.size());
+  for (size_t i = 0; i < bytes.size(); i++)
+    positions[i] = (PointPosition)bytes[i];
+  return (QueryStatus)response.status;
+}
+
+QueryClient::~QueryClient() {
+  if (descriptor >= 0)
+    close(descriptor);
+}
+
+void printLatencies(vector<double>& latencies, size_t queriesCount, double seconds) {
+  if (latencies.empty())
+    return;
+  // Nearest rank percentiles
+  sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) { return latencies[min(latencies.size() - 1, (size_t)(p * latencies.size()))]; };
+  cout << latencies.size() << " requests, " << queriesCount << " points in " << seconds << " s\n";
+  cout << "Latency: p50 " << percentile(0.5) << " us, p99 " << percentile(0.99) << " us, max " << latencies.back() << " us\n";
+  cout << "Throughput: " << (size_t)(latencies.size() / seconds) << " requests/s, " << (size_t)(queriesCount / seconds) << " queries/s\n";
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef QUERY_PROTOCOL_H
+#define QUERY_PROTOCOL_H
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "geometric_basics.h"
+
+using namespace std;
+
+/**
+ * @brief The header of a classification request sent to the query server.
+ *
+ * Every request is this header followed by count points, each as two int64 coordinates, and is answered by a
+ * QueryResponseHeader followed by count bytes, the PointPosition of every point in request order.
+ * Both sides are on the same machine, so everything is in native byte order.
+ */
+struct QueryRequestHeader {
+  char magic[4]; /**< Always "GEOQ". */
+  uint32_t polygon; /**< The index of the polygon to test the points against. */
+  uint32_t count; /**< The number of points. */
+  uint32_t reserved;
+};
+
+/**
+ * @brief The header of the answer to a request.
+ */
+struct QueryResponseHeader {
+  uint32_t status; /**< QUERY_OK, or why the points were not classified. */
+  uint32_t count; /**< The number of positions following, 0 unless the status is QUERY_OK. */
+};
+
+/**
+ * @brief The status of a request; QUERY_FAILED is never sent, clients return it when the connection fails.
+ */
+enum QueryStatus { QUERY_OK, QUERY_UNKNOWN_POLYGON, QUERY_FAILED };
+
+/**
+ * @brief The number of points a single request may carry; the server closes connections that send more.
+ */
+const uint32_t MAX_QUERY_POINTS = 1 << 20;
+
+static_assert(sizeof(QueryRequestHeader) == 16 && sizeof(QueryResponseHeader) == 8, "The query headers must be packed");
+
+/**
+ * @brief Fills the address of a Unix domain socket.
+ * @return False if the path is too long for a socket address.
+ */
+bool getSocketAddress(const string& path, sockaddr_un& address);
+
+/**
+ * @brief Writes a whole buffer to a blocking socket.
+ * @return False if the connection failed.
+ */
+bool sendAll(int socket, const void* data, size_t size);
+
+/**
+ * @brief Reads a whole buffer from a blocking socket.
+ * @return False if the connection failed or was closed before.
+ */
+bool receiveAll(int socket, void* data, size_t size);
+
+bool getSocketAddress(const string& path, sockaddr_un& address) {
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+    return false;
+  memcpy(address.sun_path, path.c_str(), path.size());
+  return true;
+}
+
+bool sendAll(int socket, const void* data, size_t size) {
+  const char* next = (const char*)data;
+  while (size > 0) {
+    ssize_t sent = send(socket, next, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR)
+      continue;
+    if (sent <= 0)
+      return false;
+    next += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+bool receiveAll(int socket, void* data, size_t size) {
+  char* next = (char*)data;
+  while (size > 0) {
+    ssize_t received = recv(socket, next, size, 0);
+    if (received < 0 && errno == EINTR)
+      continue;
+    if (received <= 0)
+      return false;
+    next += received;
+    size -= received;
+  }
+  return true;
+}
+
+#endif
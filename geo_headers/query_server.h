@@ -0,0 +1,374 @@
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include "geometric_basics.h"
+#include "point_location.h"
+#include "zone_index.h"
+#include "query_protocol.h"
+
+using namespace std;
+
+/**
+ * @brief Answers classification requests over a Unix domain socket, against polygons prepared once.
+ *
+ * One thread runs an epoll loop over the listening socket and every connection, and only moves bytes:
+ * a complete request is handed to the worker threads, and the loop sends the answer when a worker is done with it.
+ * A connection has one request with the workers at most, so its answers come in request order, and it is not read
+ * meanwhile, so a client sending faster than it is answered waits instead of filling the server memory.
+ */
+class QueryServer {
+private:
+  struct Connection {
+    int descriptor;
+    uint64_t id; /**< Unique for the server lifetime, descriptors being reused after a close. */
+    vector<char> input; /**< The bytes received and not yet handed to the workers. */
+    vector<char> output; /**< The answers not yet sent. */
+    size_t sent; /**< The number of bytes of output already sent. */
+    bool busy; /**< True while a request of the connection is with the workers. */
+  };
+  struct Job {
+    int descriptor;
+    uint64_t id;
+    uint32_t polygon;
+    vector<Point> points;
+    vector<char> response;
+  };
+
+  const ZoneIndex& zones;
+  string path;
+  int listener;
+  int events;
+  int wakeUp; /**< An eventfd the workers write to when they finish a job. */
+  int signals; /**< A signalfd receiving SIGINT and SIGTERM. */
+  vector<unique_ptr<Connection>> connections; /**< Indexed by descriptor. */
+  uint64_t nextId;
+  size_t requestsCount;
+  size_t pointsCount;
+
+  vector<thread> workers;
+  mutex jobsLock;
+  condition_variable jobsReady;
+  deque<Job> jobs;
+  bool stopping;
+  mutex doneLock;
+  vector<Job> done;
+
+  QueryServer(const QueryServer&);
+  QueryServer& operator=(const QueryServer&);
+
+  void workerLoop();
+  void acceptConnections();
+  void receive(Connection& connection);
+
+  /**
+   * @brief Hands the first request of the input to the workers, if it is complete and the connection is not busy.
+   * @return False if the request is invalid and the connection was closed.
+   */
+  bool dispatch(Connection& connection);
+
+  void send(Connection& connection);
+  void finishJobs();
+  void updateEvents(Connection& connection);
+  void closeConnection(Connection& connection);
+public:
+  /**
+   * @brief Starts the workers; SIGINT and SIGTERM are blocked for the calling thread and the threads it creates
+   * from then on, they stop run() instead.
+   * @param zones The prepared polygons, a request naming one by its id; they must outlive the server.
+   * @param workersCount The number of worker threads; 0 uses every hardware thread.
+   */
+  QueryServer(const ZoneIndex& zones, int workersCount);
+
+  /**
+   * @brief Creates the socket, replacing a socket left at the same path by a previous server.
+   * @return False if the socket could not be created.
+   */
+  bool listen(const string& socketPath);
+
+  /**
+   * @brief Serves the connections until SIGINT or SIGTERM.
+   */
+  void run();
+
+  size_t getRequestsCount() const { return requestsCount; }
+  size_t getPointsCount() const { return pointsCount; }
+
+  ~QueryServer();
+};
+
+QueryServer::QueryServer(const ZoneIndex& zones, int workersCount) : zones(zones) {
+  listener = -1;
+  nextId = 0;
+  requestsCount = 0;
+  pointsCount = 0;
+  stopping = false;
+
+  sigset_t stopSignals;
+  sigemptyset(&stopSignals);
+  sigaddset(&stopSignals, SIGINT);
+  sigaddset(&stopSignals, SIGTERM);
+  // A shell starts background jobs with SIGINT ignored, and ignored signals never reach the signalfd
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+  signals = signalfd(-1, &stopSignals, SFD_CLOEXEC);
+  wakeUp = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  events = epoll_create1(EPOLL_CLOEXEC);
+  for (int descriptor : { signals, wakeUp }) {
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = descriptor;
+    epoll_ctl(events, EPOLL_CTL_ADD, descriptor, &event);
+  }
+
+  if (workersCount <= 0)
+    workersCount = max(1u, thread::hardware_concurrency());
+  for (int i = 0; i < workersCount; i++)
+    workers.push_back(thread(&QueryServer::workerLoop, this));
+}
+
+bool QueryServer::listen(const string& socketPath) {
+  sockaddr_un address;
+  if (!getSocketAddress(socketPath, address))
+    return false;
+  // Only a socket is replaced, never a regular file given by mistake
+  struct stat status;
+  if (stat(socketPath.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+    unlink(socketPath.c_str());
+
+  listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(listener, SOMAXCONN) != 0)
+    return false;
+  path = socketPath;
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = listener;
+  return epoll_ctl(events, EPOLL_CTL_ADD, listener, &event) == 0;
+}
+
+void QueryServer::run() {
+  epoll_event ready[64];
+  while (true) {
+    int readyCount = epoll_wait(events, ready, 64, -1);
+    if (readyCount < 0 && errno == EINTR)
+      continue;
+    if (readyCount < 0)
+      return;
+    for (int i = 0; i < readyCount; i++) {
+      int descriptor = ready[i].data.fd;
+      if (descriptor == signals)
+        return;
+      if (descriptor == listener) {
+        acceptConnections();
+      } else if (descriptor == wakeUp) {
+        uint64_t finished;
+        if (read(wakeUp, &finished, sizeof(finished)) > 0)
+          finishJobs();
+      } else if (descriptor < (int)connections.size() && connections[descriptor]) {
+        Connection& connection = *connections[descriptor];
+        if (ready[i].events & (EPOLLERR | EPOLLHUP) && !(ready[i].events & EPOLLIN))
+          closeConnection(connection);
+        else if (ready[i].events & EPOLLIN)
+          receive(connection);
+        else if (ready[i].events & EPOLLOUT)
+          send(connection);
+      }
+    }
+  }
+}
+
+void QueryServer::acceptConnections() {
+  while (true) {
+    int descriptor = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (descriptor < 0)
+      return;
+    if (descriptor >= (int)connections.size())
+      connections.resize(descriptor + 1);
+    connections[descriptor].reset(new Connection{ descriptor, nextId++, {}, {}, 0, false });
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = descriptor;
+    epoll_ctl(events, EPOLL_CTL_ADD, descriptor, &event);
+  }
+}
+
+void QueryServer::receive(Connection& connection) {
+  // A single read per event keeps the input of a connection sending many requests at once bounded,
+  // the level-triggered loop comes back for the rest
+  const size_t readSize = 1 << 16;
+  size_t received = connection.input.size();
+  connection.input.resize(received + readSize);
+  ssize_t bytes = recv(connection.descriptor, connection.input.data() + received, readSize, 0);
+  if (bytes < 0 && (errno == EAGAIN || errno == EINTR)) {
+    connection.input.resize(received);
+    return;
+  }
+  if (bytes <= 0) {
+    closeConnection(connection);
+    return;
+  }
+  connection.input.resize(received + bytes);
+  if (dispatch(connection))
+    updateEvents(connection);
+}
+
+bool QueryServer::dispatch(Connection& connection) {
+  QueryRequestHeader header;
+  if (connection.busy || connection.input.size() < sizeof(header))
+    return true;
+  memcpy(&header, connection.input.data(), sizeof(header));
+  if (memcmp(header.magic, "GEOQ", 4) != 0 || header.count > MAX_QUERY_POINTS) {
+    closeConnection(connection);
+    return false;
+  }
+  size_t requestSize = sizeof(header) + header.count * sizeof(Point);
+  if (connection.input.size() < requestSize)
+    return true;
+
+  Job job;
+  job.descriptor = connection.descriptor;
+  job.id = connection.id;
+  job.polygon = header.polygon;
+  job.points.resize(header.count);
+  memcpy((void*)job.points.data(), connection.input.data() + sizeof(header), header.count * sizeof(Point));
+  connection.input.erase(connection.input.begin(), connection.input.begin() + requestSize);
+  connection.busy = true;
+  requestsCount++;
+  pointsCount += header.count;
+  {
+    unique_lock<mutex> guard(jobsLock);
+    jobs.push_back(move(job));
+  }
+  jobsReady.notify_one();
+  return true;
+}
+
+void QueryServer::workerLoop() {
+  GEO_THREAD();
+  while (true) {
+    Job job;
+    {
+      unique_lock<mutex> guard(jobsLock);
+      jobsReady.wait(guard, [&] { return stopping || !jobs.empty(); });
+      if (stopping)
+        return;
+      job = move(jobs.front());
+      jobs.pop_front();
+    }
+
+    QueryResponseHeader header = { QUERY_OK, (uint32_t)job.points.size() };
+    if (job.polygon >= zones.getZonesCount())
+      header = { QUERY_UNKNOWN_POLYGON, 0 };
+    job.response.resize(sizeof(header) + header.count);
+    memcpy(job.response.data(), &header, sizeof(header));
+    for (size_t i = 0; i < header.count; i++)
+      job.response[sizeof(header) + i] = zones.getPointPosition(job.polygon, job.points[i]);
+
+    {
+      unique_lock<mutex> guard(doneLock);
+      done.push_back(move(job));
+    }
+    // The eventfd counter cannot overflow with one write per job, so the write always succeeds
+    uint64_t finished = 1;
+    ssize_t written = write(wakeUp, &finished, sizeof(finished));
+    (void)written;
+  }
+}
+
+void QueryServer::finishJobs() {
+  vector<Job> finished;
+  {
+    unique_lock<mutex> guard(doneLock);
+    finished.swap(done);
+  }
+  for (auto& job : finished) {
+    // The connection may have been closed, and its descriptor given to a new one, while the job ran
+    if (job.descriptor >= (int)connections.size() || !connections[job.descriptor] || connections[job.descriptor]->id != job.id)
+      continue;
+    Connection& connection = *connections[job.descriptor];
+    connection.output.insert(connection.output.end(), job.response.begin(), job.response.end());
+    connection.busy = false;
+    send(connection);
+  }
+}
+
+void QueryServer::send(Connection& connection) {
+  while (connection.sent < connection.output.size()) {
+    ssize_t bytes = ::send(connection.descriptor, connection.output.data() + connection.sent, connection.output.size() - connection.sent, MSG_NOSIGNAL);
+    if (bytes < 0 && errno == EINTR)
+      continue;
+    if (bytes < 0 && errno == EAGAIN)
+      break;
+    if (bytes <= 0) {
+      closeConnection(connection);
+      return;
+    }
+    connection.sent += bytes;
+  }
+  if (connection.sent == connection.output.size()) {
+    connection.output.clear();
+    connection.sent = 0;
+  }
+  // The next request may already be waiting in the input
+  if (dispatch(connection))
+    updateEvents(connection);
+}
+
+void QueryServer::updateEvents(Connection& connection) {
+  epoll_event event = {};
+  // The connection is read only when it has nothing pending, so a client that does not read its answers is not read either
+  if (!connection.busy && connection.output.empty())
+    event.events |= EPOLLIN;
+  if (!connection.output.empty())
+    event.events |= EPOLLOUT;
+  event.data.fd = connection.descriptor;
+  epoll_ctl(events, EPOLL_CTL_MOD, connection.descriptor, &event);
+}
+
+void QueryServer::closeConnection(Connection& connection) {
+  int descriptor = connection.descriptor;
+  epoll_ctl(events, EPOLL_CTL_DEL, descriptor, nullptr);
+  close(descriptor);
+  connections[descriptor].reset();
+}
+
+QueryServer::~QueryServer() {
+  {
+    unique_lock<mutex> guard(jobsLock);
+    stopping = true;
+  }
+  jobsReady.notify_all();
+  for (auto& worker : workers)
+    worker.join();
+  for (auto& connection : connections)
+    if (connection)
+      close(connection->descriptor);
+  if (listener >= 0)
+    close(listener);
+  if (!path.empty())
+    unlink(path.c_str());
+  close(events);
+  close(wakeUp);
+  close(signals);
+}
+
+#endif
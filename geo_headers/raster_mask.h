@@ -0,0 +1,227 @@
+#ifndef RASTER_MASK_H
+#define RASTER_MASK_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "geometric_basics.h"
+#include "point_location.h"
+#include "thread_pool.h"
+#include "output_buffer.h"
+
+using namespace std;
+
+/**
+ * @brief The header of a packed mask file, followed by the rows of the mask.
+ *
+ * Every cell takes 2 bits holding its PointPosition, 4 cells per byte starting from the low bits,
+ * and every row starts on a new byte.
+ */
+struct RasterMaskHeader {
+  char magic[4]; /**< Always "GEOM". */
+  uint32_t version; /**< The format version, RasterMask::VERSION. */
+  int64_t minX; /**< The x-coordinate of the first column. */
+  int64_t minY; /**< The y-coordinate of the first row. */
+  int64_t step; /**< The distance between two columns or two rows. */
+  uint64_t width; /**< The number of columns. */
+  uint64_t height; /**< The number of rows. */
+};
+
+/**
+ * @brief The positions of all the points of a regular lattice with respect to a polygon, computed row by row.
+ *
+ * Each row is rasterized with a scanline: the crossings of the row with the edges give the inside runs,
+ * and the lattice points exactly on an edge are marked BOUNDARY, with the same half-open rule as the point locators.
+ */
+class RasterMask {
+private:
+  ll minX, minY, step;
+  ll width, height;
+  ll rowBytes;
+  vector<uint8_t> cells; /**< 2 bits per cell, rowBytes per row. */
+
+  void setCell(ll column, ll row, PointPosition position);
+
+  /**
+   * @brief Rasterizes one row from the edges that may cross it.
+   * @param crossings A scratch vector, reused between rows.
+   */
+  void rasterizeRow(ll row, const vector<Line>& edges, vector<ll>& crossings);
+public:
+  static const uint32_t VERSION = 1;
+
+  /**
+   * @param minX The x-coordinate of the first column.
+   * @param minY The y-coordinate of the first row.
+   * @param maxX The largest x-coordinate a column may have.
+   * @param maxY The largest y-coordinate a row may have.
+   * @param step The distance between two columns or two rows.
+   */
+  RasterMask(ll minX, ll minY, ll maxX, ll maxY, ll step);
+
+  /**
+   * @brief Computes the position of every cell, splitting the rows between the threads of a pool.
+   * @param polygon The polygon to rasterize.
+   * @param pool The threads to run on.
+   */
+  void rasterize(const Polygon& polygon, ThreadPool& pool);
+
+  PointPosition getCell(ll column, ll row) const { return (PointPosition)((cells[row * rowBytes + column / 4] >> (2 * (column % 4))) & 3); }
+  ll getWidth() const { return width; }
+  ll getHeight() const { return height; }
+
+  /**
+   * @brief Writes every row as runs of equal positions, like "5: 3 OUTSIDE, 4 INSIDE", the row starting with its y-coordinate.
+   * @return False if the file could not be written.
+   */
+  bool writeRuns(FileWriter& output) const;
+
+  /**
+   * @brief Writes the packed mask file: the header, then the rows.
+   * @return False if the file could not be written.
+   */
+  bool writePacked(FileWriter& output) const;
+};
+
+RasterMask::RasterMask(ll minX, ll minY, ll maxX, ll maxY, ll step) {
+  this->minX = minX;
+  this->minY = minY;
+  this->step = max(step, 1LL);
+  width = maxX < minX ? 0 : (maxX - minX) / this->step + 1;
+  height = maxY < minY ? 0 : (maxY - minY) / this->step + 1;
+  rowBytes = (width + 3) / 4;
+  cells.assign(rowBytes * height, 0);
+}
+
+void RasterMask::setCell(ll column, ll row, PointPosition position) {
+  uint8_t& cell = cells[row * rowBytes + column / 4];
+  int shift = 2 * (column % 4);
+  cell = (cell & ~(3 << shift)) | (position << shift);
+}
+
+void RasterMask::rasterize(const Polygon& polygon, ThreadPool& pool) {
+  vector<Line> edges;
+  int n = polygon.getSize();
+  for (int i = 0; i < n; i++) {
+    Point start = polygon.getPoint(i);
+    Point end = polygon.getPoint((i + 1) % n);
+    if (start.getY() > end.getY())
+      swap(start, end);
+    edges.push_back(Line(start, end));
+  }
+
+  // Each block of rows only keeps the edges reaching it, as a coarse active edge table
+  const ll blockRows = 64;
+  ll blocksCount = (height + blockRows - 1) / blockRows;
+  pool.parallelFor(blocksCount, 1, [&](size_t first, size_t last) {
+    vector<Line> blockEdges;
+    vector<ll> crossings;
+    for (size_t block = first; block < last; block++) {
+      ll firstRow = block * blockRows;
+      ll lastRow = min(height, firstRow + blockRows) - 1;
+      ll bottom = minY + firstRow * step, top = minY + lastRow * step;
+      blockEdges.clear();
+      for (auto& edge : edges)
+        if (edge.getStartPoint().getY() <= top && edge.getEndPoint().getY() >= bottom)
+          blockEdges.push_back(edge);
+      for (ll row = firstRow; row <= lastRow; row++)
+        rasterizeRow(row, blockEdges, crossings);
+    }
+  });
+}
+
+void RasterMask::rasterizeRow(ll row, const vector<Line>& edges, vector<ll>& crossings) {
+  ll y = minY + row * step;
+
+  // A point is inside when an odd number of edges cross the row strictly on its right. An edge crossing at x
+  // counts for the columns before ceil((x - minX) / step), so only that column index is kept per crossing.
+  crossings.clear();
+  for (auto& edge : edges) {
+    Point start = edge.getStartPoint(), end = edge.getEndPoint();
+    if (start.getY() > y || end.getY() <= y)
+      continue;
+    __int128 dy = end.getY() - start.getY();
+    __int128 numerator = (__int128)(start.getX() - minX) * dy + (__int128)(y - start.getY()) * (end.getX() - start.getX());
+    __int128 denominator = dy * step;
+    __int128 column = numerator >= 0 ? (numerator + denominator - 1) / denominator : -((-numerator) / denominator);
+    crossings.push_back((ll)max<__int128>(0, min<__int128>(width, column)));
+  }
+  sort(crossings.begin(), crossings.end());
+
+  // Fill the runs between the crossings, from the right where no crossing is left
+  size_t remaining = crossings.size();
+  for (ll column = width - 1; column >= 0; ) {
+    while (remaining > 0 && crossings[remaining - 1] > column)
+      remaining--;
+    ll runStart = remaining > 0 ? crossings[remaining - 1] : 0;
+    PointPosition position = (crossings.size() - remaining) % 2 == 1 ? INSIDE : OUTSIDE;
+    for (ll current = runStart; current <= column; current++)
+      setCell(current, row, position);
+    column = runStart - 1;
+  }
+
+  // The lattice points exactly on an edge, the edge endpoints included
+  for (auto& edge : edges) {
+    Point start = edge.getStartPoint(), end = edge.getEndPoint();
+    if (start.getY() > y || end.getY() < y)
+      continue;
+    if (start.getY() == end.getY()) {
+      ll left = min(start.getX(), end.getX()), right = max(start.getX(), end.getX());
+      ll firstColumn = left <= minX ? 0 : (left - minX + step - 1) / step;
+      ll lastColumn = right < minX ? -1 : min(width - 1, (right - minX) / step);
+      for (ll column = firstColumn; column <= lastColumn; column++)
+        setCell(column, row, BOUNDARY);
+      continue;
+    }
+    __int128 dy = end.getY() - start.getY();
+    __int128 numerator = (__int128)(start.getX() - minX) * dy + (__int128)(y - start.getY()) * (end.getX() - start.getX());
+    if (numerator < 0 || numerator % (dy * step) != 0)
+      continue;
+    __int128 column = numerator / (dy * step);
+    if (column < width)
+      setCell((ll)column, row, BOUNDARY);
+  }
+}
+
+bool RasterMask::writeRuns(FileWriter& output) const {
+  OutputBuffer text;
+  bool written = true;
+  for (ll row = 0; row < height; row++) {
+    text.appendInteger(minY + row * step);
+    text.append(':');
+    for (ll column = 0; column < width; ) {
+      PointPosition position = getCell(column, row);
+      ll runStart = column;
+      while (column < width && getCell(column, row) == position)
+        column++;
+      text.append(runStart == 0 ? " " : ", ");
+      text.appendInteger(column - runStart);
+      text.append(' ');
+      text.append(getPositionName(position));
+    }
+    text.append('\n');
+    if (text.getSize() >= FileWriter::FLUSH_SIZE)
+      written &= output.write(text);
+  }
+  written &= output.write(text);
+  return written;
+}
+
+bool RasterMask::writePacked(FileWriter& output) const {
+  RasterMaskHeader header;
+  memcpy(header.magic, "GEOM", 4);
+  header.version = VERSION;
+  header.minX = minX;
+  header.minY = minY;
+  header.step = step;
+  header.width = width;
+  header.height = height;
+  OutputBuffer data;
+  data.append((const char*)&header, sizeof(header));
+  data.append((const char*)cells.data(), cells.size());
+  return output.write(data);
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef RAY_CASTING_H
+#define RAY_CASTING_H
+
+#include "geometric_basics.h"
+#include "point_location.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+class RayCasting {
+private:
+  RayCasting();
+  RayCasting(const RayCasting&);
+public:
+  /**
+   * @brief Determines the position of a point with respect to a polygon.
+   *
+   * Counts the edges crossed by the horizontal ray going right from the point, with the half-open rule of
+   * edgeCrossesRay, so a ray through a vertex gets the same answer as with the other locators.
+   *
+   * @param point The point to be tested.
+   * @param polygon The polygon to be tested against.
+   * @return The position of the point: INSIDE, OUTSIDE, or BOUNDARY.
+   * @note Nothing is kept between the queries, so any number of threads can query the same polygon at once.
+   */
+  static PointPosition getPointPosition(Point point, const Polygon& polygon);
+
+  /**
+   * @brief Determines the positions of a batch of points with respect to a polygon, on every thread of a pool.
+   * @param points The points to be tested, with any integer coordinate type.
+   * @param count The number of points.
+   * @param polygon The polygon to be tested against.
+   * @param positions The preallocated output, receiving the position of points[i] at index i.
+   * @param pool The threads to run on.
+   */
+  template <class T>
+  static void getPointPositions(const BasicPoint<T>* points, size_t count, const Polygon& polygon, PointPosition* positions, ThreadPool& pool);
+};
+
+PointPosition RayCasting::getPointPosition(Point point, const Polygon& polygon) {
+  ll n = polygon.getSize();
+  long linesCrossed = 0;
+  GEO_COUNT(EDGES_SCANNED, n);
+  for (ll i = 0; i < n; i++) {
+    Point start = polygon.getPoint(i);
+    Point end = polygon.getPoint(i < n - 1 ? i + 1 : 0);
+
+    // Only the edges spanning the y of the point can touch it or cross its ray
+    if (point.getY() < min(start.getY(), end.getY()) || point.getY() > max(start.getY(), end.getY()))
+      continue;
+    // Testing every edge on its closed segment also covers the vertices and the horizontal edges
+    if (pointOnSegment(point, start, end))
+      return BOUNDARY;
+    if (edgeCrossesRay(point, start, end))
+      linesCrossed++;
+  }
+
+  if (linesCrossed % 2 == 0) return OUTSIDE;
+  else return INSIDE;
+}
+
+template <class T>
+void RayCasting::getPointPositions(const BasicPoint<T>* points, size_t count, const Polygon& polygon, PointPosition* positions, ThreadPool& pool) {
+  GEO_PHASE("classify");
+  pool.parallelFor(count, 0, [&](size_t begin, size_t end) {
+    GEO_COUNT(POINTS_CLASSIFIED, end - begin);
+    for (size_t i = begin; i < end; i++)
+      positions[i] = getPointPosition(Point(points[i]), polygon);
+  });
+}
+
+#endif
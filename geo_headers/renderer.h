@@ -3,11 +3,35 @@
 
 #include <iostream>
 #include <vector>
+#include <functional>
+#include <cmath>
 #include <SDL2/SDL.h>
 #include "geometric_basics.h"
 
 using namespace std;
 
+/**
+ * @brief A set of points already transformed into the screen pixels of their markers, all of one color,
+ * so that it is drawn with a single SDL call.
+ */
+struct PointBatch {
+  Uint8 r, g, b;
+  vector<SDL_Point> pixels;
+
+  PointBatch(Uint8 r, Uint8 g, Uint8 b): r(r), g(g), b(b) {}
+};
+
+/**
+ * @brief The view changes asked by the user since the last redraw: drag with the left button to pan, wheel to zoom.
+ */
+struct ViewChange {
+  int panX = 0; /**< The horizontal drag, in pixels, positive to the right. */
+  int panY = 0; /**< The vertical drag, in pixels, positive downwards. */
+  double zoom = 1; /**< The zoom factor, greater than 1 to zoom in. */
+  int zoomX = 0; /**< The pixel to zoom around. */
+  int zoomY = 0;
+};
+
 /**
  * @brief The Renderer class provides functionality for rendering graphics using SDL library.
  */
@@ -20,14 +44,44 @@ private:
   SDL_Window* window;
   SDL_Event event;
   float scale;
+  float centerX; /**< The world x-coordinate at the middle of the screen. */
+  float centerY; /**< The world y-coordinate at the middle of the screen. */
+  bool fixedView; /**< Set by setView, stops the scale from shrinking to fit what gets drawn. */
+  bool quitRequested;
+  SDL_Texture* sceneCache; /**< The last drawn scene, reused until the window has to be redrawn from scratch. */
+  bool sceneCacheValid;
+  SDL_Texture* pixelsTexture; /**< The streaming texture drawPixels uploads to. */
+
+  /**
+   * @brief Handles the current event.
+   * @return True if the window has to be redrawn.
+   */
+  bool handleEvent(ViewChange* change);
+  vector<SDL_Point> polygonPixels; /**< The buffer drawPolygon transforms the polygon points into, reused between calls. */
 public:
   Renderer(int screenWidth, int screenHeight, const char* windowName): SCREEN_WIDTH(screenWidth), SCREEN_HEIGHT(screenHeight), WINDOW_NAME(windowName) {
-    SDL_Init(SDL_INIT_EVERYTHING);
     scale = 10000;
+    centerX = 0;
+    centerY = 0;
+    fixedView = false;
+    quitRequested = false;
+    pixelsTexture = nullptr;
+    window = nullptr;
+    renderer = nullptr;
+    sceneCache = nullptr;
+    sceneCacheValid = false;
+    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+      return;
     window = SDL_CreateWindow( WINDOW_NAME, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-    renderer = SDL_CreateRenderer(window, -1, 0);
+    if (window != nullptr)
+      renderer = SDL_CreateRenderer(window, -1, 0);
   }
 
+  /**
+   * @brief Checks if the window could be created, which fails when there is no display.
+   */
+  bool isOpen() { return renderer != nullptr; }
+
   /**
    * @brief Checks if the application should quit.
    */
@@ -38,6 +92,26 @@ public:
    */
   bool hasEvents();
 
+  /**
+   * @brief Sleeps until the window has to be redrawn (exposed or resized) or closed.
+   * @param change If not null, panning and zooming also wake up, and the requested changes are stored there.
+   * @return False if the window was closed.
+   */
+  bool waitForRedraw(ViewChange* change = nullptr);
+
+  /**
+   * @brief Fixes the view: later draws no longer shrink the scale to fit.
+   * @param centerX The world x-coordinate at the middle of the screen.
+   * @param centerY The world y-coordinate at the middle of the screen.
+   * @param scale The number of pixels per world unit.
+   */
+  void setView(float centerX, float centerY, float scale);
+
+  /**
+   * @return The number of pixels per world unit.
+   */
+  float getScale() { return scale; }
+
   /**
    * @brief Normalizes the x-coordinate based on the screen width.
    * @param x The x-coordinate to normalize.
@@ -106,27 +180,77 @@ public:
    * @param g The green component of the color (optional, default: 40).
    * @param b The blue component of the color (optional, default: 200).
    */
-  void drawPolygon(Polygon polygon, int, int, int, bool);
+  void drawPolygon(const Polygon& polygon, int, int, int, bool);
+
+  /**
+   * @brief Sets the scale so that all the given points fit on the screen, as if they had all been drawn already.
+   * @param points The points to fit.
+   * @param count The number of points.
+   * @note Fit all the content before building point batches, they keep the pixels of the scale at build time.
+   */
+  template <class T>
+  void fit(const BasicPoint<T>* points, size_t count);
+
+  /**
+   * @brief Sets the scale so that all the points of a polygon fit on the screen.
+   * @param polygon The polygon to fit.
+   */
+  void fit(const Polygon& polygon);
+
+  /**
+   * @brief Adds the marker of a point, the same one drawPoint draws, to a batch.
+   * @param batch The batch to add to.
+   * @param point The point to add.
+   */
+  void addToBatch(PointBatch& batch, Point point);
+
+  /**
+   * @brief Draws all the markers of a batch with a single SDL call.
+   * @param batch The batch to draw.
+   */
+  void drawBatch(const PointBatch& batch);
+
+  /**
+   * @brief Draws a scene through a texture cache: the scene is drawn into the texture only the first time,
+   * or after the cache was lost, and every following call only copies the texture to the screen.
+   * @param drawScene Draws the whole scene, including the clear.
+   * @note If the renderer does not support render targets the scene is drawn directly every time.
+   */
+  void drawCached(function<void()> drawScene);
+
+  /**
+   * @brief Copies a whole screen of pixels to the screen.
+   * @param pixels The pixels, row by row, as ARGB8888.
+   */
+  void drawPixels(const uint32_t* pixels);
 
   ~Renderer() {
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    if (sceneCache != nullptr)
+      SDL_DestroyTexture(sceneCache);
+    if (pixelsTexture != nullptr)
+      SDL_DestroyTexture(pixelsTexture);
+    if (renderer != nullptr)
+      SDL_DestroyRenderer(renderer);
+    if (window != nullptr)
+      SDL_DestroyWindow(window);
     SDL_Quit();
   }
 };
 
 int Renderer::normalizeX(int x) {
   float maxX = SCREEN_WIDTH / 2.3;
-  scale = min(scale, abs((float)maxX / x));
+  if (!fixedView)
+    scale = min(scale, abs((float)maxX / x));
   
-  return SCREEN_WIDTH / 2 + scale * x;
+  return SCREEN_WIDTH / 2 + scale * (x - centerX);
 }
 
 int Renderer::normalizeY(int y) {
   float maxY = SCREEN_HEIGHT / 2.3;
-  scale = min(scale, abs((float)maxY / y));
+  if (!fixedView)
+    scale = min(scale, abs((float)maxY / y));
   
-  return SCREEN_HEIGHT / 2 - scale * y;
+  return SCREEN_HEIGHT / 2 - scale * (y - centerY);
 }
 
 bool Renderer::shouldQuit() {
@@ -137,6 +261,55 @@ bool Renderer::hasEvents() {
   return SDL_PollEvent(&event) != 0;
 }
 
+bool Renderer::handleEvent(ViewChange* change) {
+  switch (event.type) {
+    case SDL_QUIT:
+      quitRequested = true;
+      return true;
+    case SDL_RENDER_TARGETS_RESET:
+    case SDL_RENDER_DEVICE_RESET:
+      sceneCacheValid = false;
+      return true;
+    case SDL_WINDOWEVENT:
+      return event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED;
+    case SDL_MOUSEWHEEL:
+      if (change == nullptr || event.wheel.y == 0)
+        return false;
+      change->zoom *= pow(1.25, event.wheel.y);
+      SDL_GetMouseState(&change->zoomX, &change->zoomY);
+      return true;
+    case SDL_MOUSEMOTION:
+      if (change == nullptr || !(event.motion.state & SDL_BUTTON_LMASK))
+        return false;
+      change->panX += event.motion.xrel;
+      change->panY += event.motion.yrel;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool Renderer::waitForRedraw(ViewChange* change) {
+  if (change != nullptr)
+    *change = ViewChange();
+  while (!quitRequested && SDL_WaitEvent(&event) != 0) {
+    if (!handleEvent(change))
+      continue;
+    // Merge the events already queued into a single redraw
+    while (!quitRequested && SDL_PollEvent(&event) != 0)
+      handleEvent(change);
+    return !quitRequested;
+  }
+  return false;
+}
+
+void Renderer::setView(float centerX, float centerY, float scale) {
+  this->centerX = centerX;
+  this->centerY = centerY;
+  this->scale = scale;
+  fixedView = true;
+}
+
 void Renderer::clear() {
   SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
   SDL_RenderClear(renderer);
@@ -180,20 +353,80 @@ void Renderer::drawLine(Line line, int r = 181, int g = 14, int b = 237) {
   );
 }
 
-void Renderer::drawPolygon(Polygon polygon, int r = 0, int g = 40, int b = 200, bool drawLastLine = true) {
+void Renderer::drawPolygon(const Polygon& polygon, int r = 0, int g = 40, int b = 200, bool drawLastLine = true) {
   SDL_SetRenderDrawColor(renderer, r, g, b, 255);
 
   int numPoints = polygon.getSize();
-  SDL_Point* points = new SDL_Point[numPoints];
+  if (numPoints == 0)
+    return;
+  polygonPixels.resize(numPoints);
   for (int i = 0; i < numPoints; i++) {
     Point p = polygon.getPoint(i);
-    points[i].x = normalizeX(p.getX());
-    points[i].y = normalizeY(p.getY());
+    polygonPixels[i].x = normalizeX(p.getX());
+    polygonPixels[i].y = normalizeY(p.getY());
   }
-  SDL_RenderDrawLines(renderer, points, numPoints);
+  SDL_RenderDrawLines(renderer, polygonPixels.data(), numPoints);
   if (drawLastLine)
-    SDL_RenderDrawLine(renderer, points[numPoints - 1].x, points[numPoints - 1].y, points[0].x, points[0].y);
-  delete[] points;
+    SDL_RenderDrawLine(renderer, polygonPixels[numPoints - 1].x, polygonPixels[numPoints - 1].y, polygonPixels[0].x, polygonPixels[0].y);
+}
+
+template <class T>
+void Renderer::fit(const BasicPoint<T>* points, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    normalizeX(points[i].getX());
+    normalizeY(points[i].getY());
+  }
+}
+
+void Renderer::fit(const Polygon& polygon) {
+  for (int i = 0; i < polygon.getSize(); i++) {
+    normalizeX(polygon.getPoint(i).getX());
+    normalizeY(polygon.getPoint(i).getY());
+  }
+}
+
+void Renderer::addToBatch(PointBatch& batch, Point point) {
+  int x = normalizeX(point.getX());
+  int y = normalizeY(point.getY());
+
+  // the thick center and the X of drawPoint, pixel by pixel
+  static const int offsets[13][2] = {
+    {0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1},
+    {-1, -1}, {1, 1}, {-2, -2}, {2, 2},
+    {1, -1}, {-1, 1}, {2, -2}, {-2, 2}
+  };
+  for (auto& offset : offsets)
+    batch.pixels.push_back({x + offset[0], y + offset[1]});
+}
+
+void Renderer::drawBatch(const PointBatch& batch) {
+  SDL_SetRenderDrawColor(renderer, batch.r, batch.g, batch.b, 255);
+  SDL_RenderDrawPoints(renderer, batch.pixels.data(), batch.pixels.size());
+}
+
+void Renderer::drawCached(function<void()> drawScene) {
+  if (sceneCache == nullptr)
+    sceneCache = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+  if (!sceneCacheValid) {
+    if (sceneCache == nullptr || SDL_SetRenderTarget(renderer, sceneCache) != 0) {
+      drawScene();
+      return;
+    }
+    drawScene();
+    SDL_SetRenderTarget(renderer, nullptr);
+    sceneCacheValid = true;
+  }
+  SDL_RenderCopy(renderer, sceneCache, nullptr, nullptr);
+}
+
+void Renderer::drawPixels(const uint32_t* pixels) {
+  if (pixelsTexture == nullptr)
+    pixelsTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
+  if (pixelsTexture == nullptr)
+    return;
+  SDL_UpdateTexture(pixelsTexture, nullptr, pixels, SCREEN_WIDTH * sizeof(uint32_t));
+  SDL_RenderCopy(renderer, pixelsTexture, nullptr, nullptr);
 }
 
 #endif
\ No newline at end of file
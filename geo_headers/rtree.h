@@ -0,0 +1,133 @@
+#ifndef RTREE_H
+#define RTREE_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "geometric_basics.h"
+
+using namespace std;
+
+/**
+ * @brief An axis aligned rectangle, borders included.
+ */
+struct BoundingBox {
+  ll minX, minY, maxX, maxY;
+
+  /**
+   * @return The bounding box of a polygon, from its extreme coordinates.
+   */
+  static BoundingBox of(const Polygon& polygon) {
+    return { polygon.getLeftExtreme(), polygon.getBottomExtreme(), polygon.getRightExtreme(), polygon.getTopExtreme() };
+  }
+
+  bool contains(Point point) const {
+    return minX <= point.getX() && point.getX() <= maxX && minY <= point.getY() && point.getY() <= maxY;
+  }
+
+  void extend(const BoundingBox& box) {
+    minX = min(minX, box.minX);
+    minY = min(minY, box.minY);
+    maxX = max(maxX, box.maxX);
+    maxY = max(maxY, box.maxY);
+  }
+};
+
+/**
+ * @brief A static R-tree over bounding boxes, packed with the Sort-Tile-Recursive method.
+ *
+ * The boxes are sorted in vertical slices by x, then by y inside each slice, and grouped NODE_SIZE by NODE_SIZE;
+ * each level groups the nodes of the level below the same way. All the levels are stored in one array,
+ * from the leaves to the root, so the tree has no pointers and a node is found from its position.
+ */
+class PackedRTree {
+private:
+  vector<BoundingBox> boxes; /**< The items in packed order, then the nodes of every level, the root last. */
+  vector<int> items; /**< The item id of each of the first boxes. */
+  vector<size_t> levelStart; /**< The position in boxes of the first node of each level, plus the end of the array. */
+public:
+  static const int NODE_SIZE = 16;
+
+  PackedRTree() {}
+  PackedRTree(const vector<BoundingBox>& itemBoxes);
+
+  /**
+   * @brief Packs the boxes of the items, replacing any previous content.
+   * @param itemBoxes The box of each item; the item ids are the positions in this vector.
+   */
+  void build(const vector<BoundingBox>& itemBoxes);
+
+  /**
+   * @brief Finds the items whose box contains a point.
+   * @param point The point to look for.
+   * @param results Receives the ids of the items, replacing its content, in no particular order.
+   */
+  void query(Point point, vector<int>& results) const;
+};
+
+PackedRTree::PackedRTree(const vector<BoundingBox>& itemBoxes) {
+  build(itemBoxes);
+}
+
+void PackedRTree::build(const vector<BoundingBox>& itemBoxes) {
+  size_t count = itemBoxes.size();
+  items.resize(count);
+  for (size_t i = 0; i < count; i++)
+    items[i] = i;
+
+  // Sort by the x-coordinate of the centers, then by y inside each vertical slice
+  auto centerX = [&](int item) { return itemBoxes[item].minX / 2 + itemBoxes[item].maxX / 2; };
+  auto centerY = [&](int item) { return itemBoxes[item].minY / 2 + itemBoxes[item].maxY / 2; };
+  sort(items.begin(), items.end(), [&](int a, int b) { return centerX(a) < centerX(b); });
+  size_t leavesCount = (count + NODE_SIZE - 1) / NODE_SIZE;
+  size_t slicesCount = max<size_t>(1, ceil(sqrt((double)leavesCount)));
+  size_t sliceSize = ((leavesCount + slicesCount - 1) / slicesCount) * NODE_SIZE;
+  for (size_t start = 0; start < count; start += sliceSize) {
+    auto sliceEnd = items.begin() + min(count, start + sliceSize);
+    sort(items.begin() + start, sliceEnd, [&](int a, int b) { return centerY(a) < centerY(b); });
+  }
+
+  boxes.clear();
+  levelStart.assign(1, 0);
+  for (int item : items)
+    boxes.push_back(itemBoxes[item]);
+  levelStart.push_back(boxes.size());
+  while (levelStart.back() - levelStart[levelStart.size() - 2] > 1) {
+    size_t begin = levelStart[levelStart.size() - 2], end = levelStart.back();
+    for (size_t first = begin; first < end; first += NODE_SIZE) {
+      BoundingBox node = boxes[first];
+      for (size_t child = first + 1; child < min(end, first + NODE_SIZE); child++)
+        node.extend(boxes[child]);
+      boxes.push_back(node);
+    }
+    levelStart.push_back(boxes.size());
+  }
+}
+
+void PackedRTree::query(Point point, vector<int>& results) const {
+  results.clear();
+  if (boxes.empty())
+    return;
+
+  // Each stack entry is a node position with its level, level 0 being the items
+  vector<pair<size_t, int>> stack;
+  int rootLevel = levelStart.size() - 2;
+  stack.push_back({ boxes.size() - 1, rootLevel });
+  while (!stack.empty()) {
+    size_t node = stack.back().first;
+    int level = stack.back().second;
+    stack.pop_back();
+    if (!boxes[node].contains(point))
+      continue;
+    if (level == 0) {
+      results.push_back(items[node]);
+      continue;
+    }
+    size_t first = levelStart[level - 1] + (node - levelStart[level]) * NODE_SIZE;
+    size_t last = min(levelStart[level], first + NODE_SIZE);
+    for (size_t child = first; child < last; child++)
+      stack.push_back({ child, level - 1 });
+  }
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef SLAB_INDEX_H
+#define SLAB_INDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "geometric_basics.h"
+#include "point_location.h"
+
+using namespace std;
+
+/**
+ * @brief A point location index that splits the plane into horizontal slabs at the polygon vertices y-coordinates.
+ *
+ * Every slab keeps the edges spanning it, so a query only binary searches its slab and tests the k edges inside it,
+ * in O(log N + k), instead of walking the whole polygon. The index is built once and can be reused for any number of queries.
+ *
+ * @note The total size is the sum of the slabs each edge spans: O(N) for typical polygons, O(N^2) in the worst case,
+ * such as a comb whose teeth all have different heights. build can refuse the polygons past a given size.
+ */
+class SlabIndex {
+private:
+  vector<Line> edges; /**< The non-horizontal edges, oriented upwards. */
+  vector<ll> slabY; /**< The sorted distinct y-coordinates of the vertices; slab i covers [slabY[i], slabY[i + 1]). */
+  vector<size_t> slabStart; /**< The position in slabEdges where the edges of each slab start; the total can pass 2^31. */
+  vector<int> slabEdges; /**< The indexes of the edges spanning each slab, slab after slab. */
+  BoundaryIndex boundary; /**< The vertices and the horizontal edges, for the boundary cases. */
+public:
+  SlabIndex() {}
+  SlabIndex(const Polygon& polygon);
+
+  /**
+   * @brief Builds the slabs for a polygon, replacing any previous content.
+   * @param polygon The polygon to index.
+   * @param maxEntries The largest number of (slab, edge) pairs to store; the default has no limit.
+   * @return False, leaving the index empty, if the polygon needs more than maxEntries pairs.
+   */
+  bool build(const Polygon& polygon, size_t maxEntries = SIZE_MAX);
+
+  /**
+   * @brief Determines the position of a point with respect to the indexed polygon.
+   * @param point The point to be tested.
+   * @return The position of the point: INSIDE, OUTSIDE, or BOUNDARY.
+   */
+  PointPosition getPointPosition(Point point) const;
+
+  /**
+   * @return The number of slabs.
+   */
+  int getSlabCount() const { return max((int)slabY.size() - 1, 0); }
+
+  /**
+   * @return The number of (slab, edge) pairs stored by the index.
+   */
+  size_t getEntryCount() const { return slabEdges.size(); }
+};
+
+SlabIndex::SlabIndex(const Polygon& polygon) {
+  build(polygon);
+}
+
+bool SlabIndex::build(const Polygon& polygon, size_t maxEntries) {
+  GEO_PHASE("prepare");
+  edges.clear();
+  slabY.clear();
+  slabStart.clear();
+  slabEdges.clear();
+  boundary.build(polygon);
+
+  int n = polygon.getSize();
+  for (int i = 0; i < n; i++) {
+    Point start = polygon.getPoint(i);
+    Point end = polygon.getPoint((i + 1) % n);
+    slabY.push_back(start.getY());
+    if (start.getY() == end.getY())
+      continue;
+    if (start.getY() > end.getY())
+      swap(start, end);
+    edges.push_back(Line(start, end));
+  }
+  sort(slabY.begin(), slabY.end());
+  slabY.erase(unique(slabY.begin(), slabY.end()), slabY.end());
+
+  // An edge spans every slab between the slabs of its endpoints; the sizes of the slabs are counted from
+  // where each edge starts and stops spanning them, so an oversized index is found before it is allocated
+  int slabCount = getSlabCount();
+  vector<int> firstSlab(edges.size()), lastSlab(edges.size());
+  vector<ll> spanChange(slabCount + 1, 0);
+  size_t entriesCount = 0;
+  for (int i = 0; i < (int)edges.size(); i++) {
+    firstSlab[i] = lower_bound(slabY.begin(), slabY.end(), edges[i].getStartPoint().getY()) - slabY.begin();
+    lastSlab[i] = lower_bound(slabY.begin(), slabY.end(), edges[i].getEndPoint().getY()) - slabY.begin();
+    spanChange[firstSlab[i]]++;
+    spanChange[lastSlab[i]]--;
+    entriesCount += lastSlab[i] - firstSlab[i];
+  }
+  if (entriesCount > maxEntries) {
+    edges.clear();
+    slabY.clear();
+    boundary = BoundaryIndex();
+    return false;
+  }
+
+  slabStart.assign(slabCount + 1, 0);
+  ll spanning = 0;
+  for (int slab = 0; slab < slabCount; slab++) {
+    spanning += spanChange[slab];
+    slabStart[slab + 1] = slabStart[slab] + spanning;
+  }
+
+  slabEdges.resize(entriesCount);
+  vector<size_t> filled(slabStart.begin(), slabStart.end() - 1);
+  for (int i = 0; i < (int)edges.size(); i++)
+    for (int slab = firstSlab[i]; slab < lastSlab[i]; slab++)
+      slabEdges[filled[slab]++] = i;
+  return true;
+}
+
+PointPosition SlabIndex::getPointPosition(Point point) const {
+  if (boundary.contains(point))
+    return BOUNDARY;
+
+  int slab = upper_bound(slabY.begin(), slabY.end(), point.getY()) - slabY.begin() - 1;
+  if (slab < 0 || slab >= getSlabCount())
+    return OUTSIDE;
+
+  // Every edge of the slab spans the whole height of the ray, so only its side matters
+  long linesCrossed = 0;
+  GEO_COUNT(EDGES_SCANNED, slabStart[slab + 1] - slabStart[slab]);
+  for (size_t i = slabStart[slab]; i < slabStart[slab + 1]; i++) {
+    ll orientation = orientationTest(edges[slabEdges[i]], point);
+    if (orientation == 0)
+      return BOUNDARY;
+    if (orientation > 0)
+      linesCrossed++;
+  }
+
+  if (linesCrossed % 2 == 0) return OUTSIDE;
+  else return INSIDE;
+}
+
+#endif
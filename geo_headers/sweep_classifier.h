@@ -0,0 +1,290 @@
+#ifndef SWEEP_CLASSIFIER_H
+#define SWEEP_CLASSIFIER_H
+
+#include <vector>
+#include <algorithm>
+#include <random>
+#include "geometric_basics.h"
+#include "point_location.h"
+
+using namespace std;
+
+/**
+ * @brief Classifies a whole batch of points at once, sweeping a horizontal line upwards over the polygon.
+ *
+ * The edges crossed by the sweep line are kept ordered from left to right in an implicit treap,
+ * so the crossing number of a point is the number of active edges on its right, found in O(log N).
+ * Sorting the points and the edge events makes the whole batch O((N + M) log(N + M)).
+ *
+ * The order of the active edges only holds while they do not cross, so the polygon must be simple.
+ * Adjacent edges are checked for intersections as in the Shamos-Hoey algorithm, and classify() reports
+ * the polygons it cannot handle.
+ */
+class SweepClassifier {
+private:
+  /**
+   * @brief A treap node, one per non-horizontal edge; the treap is ordered by position, not by a key.
+   */
+  struct Node {
+    int left, right, parent;
+    int size;
+    unsigned priority;
+  };
+
+  vector<Line> edges; /**< The non-horizontal edges, oriented upwards. */
+  vector<Node> nodes; /**< The node of edges[i] is nodes[i]. */
+  int root;
+  bool crossingFound; /**< True once two active edges were found to touch or cross. */
+  BoundaryIndex boundary; /**< The vertices and the horizontal edges, for the boundary cases. */
+
+  int size(int node) const { return node == -1 ? 0 : nodes[node].size; }
+  void update(int node);
+  int merge(int first, int second);
+  void split(int node, int count, int& first, int& second);
+  int getRank(int node) const;
+  int getNodeAt(int rank) const;
+
+  /**
+   * @return True if the new edge, starting on the sweep line, goes left of an active edge.
+   */
+  bool goesBefore(int newEdge, int activeEdge);
+
+  /**
+   * @brief Checks two edges that became neighbours on the sweep line.
+   */
+  void checkNeighbours(int first, int second);
+
+  void insertEdge(int edge);
+  void eraseEdge(int edge);
+public:
+  SweepClassifier(const Polygon& polygon);
+
+  /**
+   * @brief Classifies all the points in one sweep.
+   * @param points The points to classify, with any integer coordinate type.
+   * @param count The number of points.
+   * @param positions The preallocated output, receiving the position of points[i] at index i.
+   * @return False if the polygon is not simple; the positions are then not meaningful.
+   */
+  template <class T>
+  bool classify(const BasicPoint<T>* points, size_t count, PointPosition* positions);
+};
+
+SweepClassifier::SweepClassifier(const Polygon& polygon) {
+  GEO_PHASE("prepare");
+  boundary.build(polygon);
+  int n = polygon.getSize();
+  for (int i = 0; i < n; i++) {
+    Point start = polygon.getPoint(i);
+    Point end = polygon.getPoint((i + 1) % n);
+    if (start.getY() == end.getY())
+      continue;
+    if (start.getY() > end.getY())
+      swap(start, end);
+    edges.push_back(Line(start, end));
+  }
+  root = -1;
+  crossingFound = false;
+}
+
+void SweepClassifier::update(int node) {
+  Node& current = nodes[node];
+  current.size = 1 + size(current.left) + size(current.right);
+  if (current.left != -1)
+    nodes[current.left].parent = node;
+  if (current.right != -1)
+    nodes[current.right].parent = node;
+}
+
+int SweepClassifier::merge(int first, int second) {
+  if (first == -1 || second == -1)
+    return first == -1 ? second : first;
+  if (nodes[first].priority > nodes[second].priority) {
+    nodes[first].right = merge(nodes[first].right, second);
+    update(first);
+    return first;
+  }
+  nodes[second].left = merge(first, nodes[second].left);
+  update(second);
+  return second;
+}
+
+void SweepClassifier::split(int node, int count, int& first, int& second) {
+  if (node == -1) {
+    first = second = -1;
+    return;
+  }
+  if (size(nodes[node].left) < count) {
+    split(nodes[node].right, count - size(nodes[node].left) - 1, nodes[node].right, second);
+    first = node;
+  } else {
+    split(nodes[node].left, count, first, nodes[node].left);
+    second = node;
+  }
+  update(node);
+}
+
+int SweepClassifier::getRank(int node) const {
+  int rank = size(nodes[node].left);
+  for (int current = node; current != root; current = nodes[current].parent) {
+    int parent = nodes[current].parent;
+    if (nodes[parent].right == current)
+      rank += size(nodes[parent].left) + 1;
+  }
+  return rank;
+}
+
+int SweepClassifier::getNodeAt(int rank) const {
+  int node = root;
+  while (node != -1) {
+    int leftSize = size(nodes[node].left);
+    if (rank == leftSize)
+      return node;
+    if (rank < leftSize) {
+      node = nodes[node].left;
+    } else {
+      rank -= leftSize + 1;
+      node = nodes[node].right;
+    }
+  }
+  return -1;
+}
+
+bool SweepClassifier::goesBefore(int newEdge, int activeEdge) {
+  Point start = edges[newEdge].getStartPoint();
+  ll orientation = orientationTest(edges[activeEdge], start);
+  if (orientation == 0) {
+    // Two edges leaving the same vertex are ordered by their other end, anything else touching is not simple
+    if (!(edges[activeEdge].getStartPoint() == start))
+      crossingFound = true;
+    orientation = orientationTest(edges[activeEdge], edges[newEdge].getEndPoint());
+    if (orientation == 0)
+      crossingFound = true;
+  }
+  return orientation > 0;
+}
+
+void SweepClassifier::checkNeighbours(int first, int second) {
+  if (first == -1 || second == -1)
+    return;
+  Point a = edges[first].getStartPoint(), b = edges[first].getEndPoint();
+  Point c = edges[second].getStartPoint(), d = edges[second].getEndPoint();
+  ll o1 = orientationTest(a, b, c), o2 = orientationTest(a, b, d);
+  ll o3 = orientationTest(c, d, a), o4 = orientationTest(c, d, b);
+
+  // Edges sharing a vertex may only meet there
+  if (a == c || b == d || a == d || b == c) {
+    Point shared = (a == c || a == d) ? a : b;
+    Point firstOther = shared == a ? b : a;
+    Point secondOther = shared == c ? d : c;
+    if (orientationTest(shared, firstOther, secondOther) == 0 &&
+        (__int128)(firstOther.getX() - shared.getX()) * (secondOther.getX() - shared.getX()) +
+        (__int128)(firstOther.getY() - shared.getY()) * (secondOther.getY() - shared.getY()) > 0)
+      crossingFound = true;
+    return;
+  }
+  if (((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)) && ((o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0)))
+    crossingFound = true;
+  if ((o1 == 0 && pointOnSegment(c, a, b)) || (o2 == 0 && pointOnSegment(d, a, b)) ||
+      (o3 == 0 && pointOnSegment(a, c, d)) || (o4 == 0 && pointOnSegment(b, c, d)))
+    crossingFound = true;
+}
+
+void SweepClassifier::insertEdge(int edge) {
+  int position = 0;
+  for (int node = root; node != -1; ) {
+    if (goesBefore(edge, node)) {
+      node = nodes[node].left;
+    } else {
+      position += size(nodes[node].left) + 1;
+      node = nodes[node].right;
+    }
+  }
+  int first, second;
+  split(root, position, first, second);
+  root = merge(merge(first, edge), second);
+  nodes[root].parent = -1;
+  checkNeighbours(getNodeAt(position - 1), edge);
+  checkNeighbours(edge, getNodeAt(position + 1));
+}
+
+void SweepClassifier::eraseEdge(int edge) {
+  int rank = getRank(edge);
+  int first, middle, second;
+  split(root, rank, first, second);
+  split(second, 1, middle, second);
+  root = merge(first, second);
+  if (root != -1)
+    nodes[root].parent = -1;
+  checkNeighbours(getNodeAt(rank - 1), getNodeAt(rank));
+}
+
+template <class T>
+bool SweepClassifier::classify(const BasicPoint<T>* points, size_t count, PointPosition* positions) {
+  GEO_PHASE("classify");
+  GEO_COUNT(POINTS_CLASSIFIED, count);
+  mt19937 random(edges.size());
+  nodes.assign(edges.size(), Node());
+  for (auto& node : nodes)
+    node = { -1, -1, -1, 1, (unsigned)random() };
+  root = -1;
+  crossingFound = false;
+
+  vector<int> byStart(edges.size()), byEnd(edges.size());
+  for (int i = 0; i < (int)edges.size(); i++)
+    byStart[i] = byEnd[i] = i;
+  sort(byStart.begin(), byStart.end(), [&](int a, int b) { return edges[a].getStartPoint().getY() < edges[b].getStartPoint().getY(); });
+  sort(byEnd.begin(), byEnd.end(), [&](int a, int b) { return edges[a].getEndPoint().getY() < edges[b].getEndPoint().getY(); });
+  vector<size_t> queries(count);
+  for (size_t i = 0; i < count; i++)
+    queries[i] = i;
+  sort(queries.begin(), queries.end(), [&](size_t a, size_t b) { return points[a].getY() < points[b].getY(); });
+
+  // An edge is active for the rows in [start y, end y), the half-open crossing rule.
+  // The events are replayed row by row, so a new edge is only compared with edges active on its starting row.
+  size_t started = 0, ended = 0;
+  for (size_t query : queries) {
+    Point point(points[query]);
+    while (true) {
+      ll row = point.getY() + 1;
+      if (ended < byEnd.size())
+        row = min(row, edges[byEnd[ended]].getEndPoint().getY());
+      if (started < byStart.size())
+        row = min(row, edges[byStart[started]].getStartPoint().getY());
+      if (row > point.getY())
+        break;
+      while (ended < byEnd.size() && edges[byEnd[ended]].getEndPoint().getY() == row)
+        eraseEdge(byEnd[ended++]);
+      while (started < byStart.size() && edges[byStart[started]].getStartPoint().getY() == row)
+        insertEdge(byStart[started++]);
+    }
+    if (crossingFound)
+      return false;
+
+    if (boundary.contains(point)) {
+      positions[query] = BOUNDARY;
+      continue;
+    }
+    long linesCrossed = 0;
+    bool onEdge = false;
+    for (int node = root; node != -1; ) {
+      ll orientation = orientationTest(edges[node], point);
+      if (orientation == 0) {
+        onEdge = true;
+        break;
+      }
+      if (orientation > 0) {
+        linesCrossed += size(nodes[node].right) + 1;
+        node = nodes[node].left;
+      } else {
+        node = nodes[node].right;
+      }
+    }
+    if (onEdge) positions[query] = BOUNDARY;
+    else if (linesCrossed % 2 == 0) positions[query] = OUTSIDE;
+    else positions[query] = INSIDE;
+  }
+  return true;
+}
+
+#endif
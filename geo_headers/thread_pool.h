@@ -0,0 +1,138 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include "instrumentation.h"
+
+using namespace std;
+
+/**
+ * @brief A fixed set of worker threads that split index ranges between them.
+ *
+ * The range is cut into chunks that the workers and the calling thread grab from a shared counter,
+ * so threads that finish early keep taking work from the ones that got slower chunks.
+ */
+class ThreadPool {
+private:
+  vector<thread> workers;
+  mutex lock;
+  condition_variable wakeUp; /**< Signals the workers that a new range is available or that the pool stops. */
+  condition_variable finished; /**< Signals the caller that a worker is done with the current range. */
+  function<void(size_t, size_t)> task;
+  atomic<size_t> nextIndex;
+  size_t endIndex;
+  size_t chunkSize;
+  long generation; /**< Incremented for every range, so each worker runs it exactly once. */
+  int busyWorkers;
+  bool stopping;
+
+  void workerLoop();
+  void runChunks();
+public:
+  /**
+   * @param threadsCount The total number of threads, including the caller; 0 uses every hardware thread.
+   */
+  ThreadPool(int threadsCount = 0);
+
+  /**
+   * @return The total number of threads working on a range, including the caller.
+   */
+  int getThreadsCount() const { return workers.size() + 1; }
+
+  /**
+   * @brief Runs a task over [0, count) in chunks, on every thread of the pool, and waits for it to finish.
+   * @param count The size of the range.
+   * @param chunk The number of indexes a thread takes at once; 0 picks a size that gives every thread several chunks.
+   * @param body Called with [begin, end) for every chunk, possibly from several threads at once.
+   * @note Must not be called from inside a task of the same pool.
+   */
+  void parallelFor(size_t count, size_t chunk, function<void(size_t, size_t)> body);
+
+  ~ThreadPool();
+};
+
+ThreadPool::ThreadPool(int threadsCount) {
+  if (threadsCount <= 0)
+    threadsCount = max(1u, thread::hardware_concurrency());
+  nextIndex = 0;
+  endIndex = 0;
+  chunkSize = 1;
+  generation = 0;
+  busyWorkers = 0;
+  stopping = false;
+  for (int i = 1; i < threadsCount; i++)
+    workers.push_back(thread(&ThreadPool::workerLoop, this));
+}
+
+void ThreadPool::runChunks() {
+  while (true) {
+    size_t begin = nextIndex.fetch_add(chunkSize);
+    if (begin >= endIndex)
+      return;
+    task(begin, min(begin + chunkSize, endIndex));
+  }
+}
+
+void ThreadPool::workerLoop() {
+  GEO_THREAD();
+  long seenGeneration = 0;
+  while (true) {
+    {
+      unique_lock<mutex> guard(lock);
+      wakeUp.wait(guard, [&] { return stopping || generation != seenGeneration; });
+      if (stopping)
+        return;
+      seenGeneration = generation;
+    }
+    runChunks();
+    {
+      unique_lock<mutex> guard(lock);
+      if (--busyWorkers == 0)
+        finished.notify_one();
+    }
+  }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t chunk, function<void(size_t, size_t)> body) {
+  if (count == 0)
+    return;
+  if (chunk == 0)
+    chunk = max((size_t)1, count / (getThreadsCount() * 8));
+  if (workers.empty() || count <= chunk) {
+    body(0, count);
+    return;
+  }
+
+  {
+    unique_lock<mutex> guard(lock);
+    task = body;
+    chunkSize = chunk;
+    endIndex = count;
+    nextIndex = 0;
+    busyWorkers = workers.size();
+    generation++;
+  }
+  wakeUp.notify_all();
+  runChunks();
+
+  unique_lock<mutex> guard(lock);
+  finished.wait(guard, [&] { return busyWorkers == 0; });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    unique_lock<mutex> guard(lock);
+    stopping = true;
+  }
+  wakeUp.notify_all();
+  for (auto& worker : workers)
+    worker.join();
+}
+
+#endif
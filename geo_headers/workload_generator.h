@@ -0,0 +1,156 @@
+#ifndef WORKLOAD_GENERATOR_H
+#define WORKLOAD_GENERATOR_H
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include "geometric_basics.h"
+#include "convex_hull.h"
+#include "rtree.h"
+
+using namespace std;
+
+/**
+ * @brief Builds synthetic polygons and point sets, reproducible from a seed, for the benchmarks.
+ *
+ * Every polygon is simple and fits in a disk of radius RADIUS around the origin:
+ * - random: an x-monotone polygon through random points, with jagged chains;
+ * - convex: the hull of random points on a circle, so it may have a few vertices less than asked;
+ * - star: vertices at evenly spaced angles and random distances from the center;
+ * - clustered: star-shaped too, but the vertices crowd around a few directions, giving cells of very different sizes;
+ * - spiral: a band winding four times around the center, whose horizontal lines cross many edges.
+ *
+ * The point sets are drawn around the bounding box of a polygon:
+ * - uniform: uniform in the box enlarged by a tenth on every side;
+ * - gaussian: normal around the box center, most points falling inside the polygon;
+ * - circle: on the circle inscribed in the box, close to the boundary of round polygons.
+ */
+class WorkloadGenerator {
+private:
+  mt19937_64 random;
+
+  double uniform(double low, double high) { return uniform_real_distribution<double>(low, high)(random); }
+
+  /**
+   * @brief Makes a star-shaped polygon from vertex angles, at random distances between two radii.
+   */
+  void makeStar(vector<double> angles, double minRadius, Polygon& polygon);
+public:
+  static constexpr double RADIUS = 1e6;
+
+  WorkloadGenerator(uint64_t seed) : random(seed) {}
+
+  /**
+   * @param kind random, convex, star, clustered or spiral.
+   * @param size The number of vertices, at least 4, and at least 64 for a spiral so that its arms do not cross.
+   * @param polygon Receives the polygon, replacing its content.
+   * @return False if the kind is unknown.
+   */
+  bool makePolygon(const string& kind, int size, Polygon& polygon);
+
+  /**
+   * @param kind uniform, gaussian or circle.
+   * @param count The number of points.
+   * @param box The bounding box of the polygon the points are meant for.
+   * @param points Receives the points, replacing its content.
+   * @return False if the kind is unknown.
+   */
+  bool makePoints(const string& kind, size_t count, const BoundingBox& box, vector<Point>& points);
+};
+
+void WorkloadGenerator::makeStar(vector<double> angles, double minRadius, Polygon& polygon) {
+  sort(angles.begin(), angles.end());
+  for (double angle : angles) {
+    double radius = uniform(minRadius, RADIUS);
+    Point point(llround(radius * cos(angle)), llround(radius * sin(angle)));
+    polygon.addPoint(point);
+  }
+}
+
+bool WorkloadGenerator::makePolygon(const string& kind, int size, Polygon& polygon) {
+  polygon = Polygon();
+  size = max(size, 4);
+  vector<double> angles(size);
+  if (kind == "random") {
+    // The points above the line between the extremes go right to left, the others left to right
+    vector<Point> points;
+    for (int i = 0; i < size; i++)
+      points.push_back(Point(llround(uniform(-RADIUS, RADIUS)), llround(uniform(-RADIUS, RADIUS))));
+    sort(points.begin(), points.end());
+    points.erase(unique(points.begin(), points.end()), points.end());
+    vector<Point> lower, upper;
+    for (auto point : points)
+      (orientationTest(points.front(), points.back(), point) > 0 ? upper : lower).push_back(point);
+    lower.insert(lower.end(), upper.rbegin(), upper.rend());
+    polygon = Polygon(lower);
+  } else if (kind == "convex") {
+    vector<Point> points;
+    for (int i = 0; i < size; i++) {
+      double angle = uniform(0, 2 * M_PI);
+      points.push_back(Point(llround(RADIUS * cos(angle)), llround(RADIUS * sin(angle))));
+    }
+    sort(points.begin(), points.end());
+    ConvexHull hull;
+    hull.build(points.data(), points.size());
+    vector<Point> vertices = hull.getLower();
+    vertices.insert(vertices.end(), hull.getUpper().begin() + 1, hull.getUpper().end() - 1);
+    polygon = Polygon(vertices);
+  } else if (kind == "star") {
+    for (int i = 0; i < size; i++)
+      angles[i] = 2 * M_PI * i / size;
+    makeStar(angles, 0.2 * RADIUS, polygon);
+  } else if (kind == "clustered") {
+    vector<double> centers(8);
+    for (auto& center : centers)
+      center = uniform(0, 2 * M_PI);
+    normal_distribution<double> spread(0, 0.05);
+    for (auto& angle : angles)
+      angle = fmod(centers[random() % centers.size()] + spread(random) + 4 * M_PI, 2 * M_PI);
+    makeStar(angles, 0.5 * RADIUS, polygon);
+  } else if (kind == "spiral") {
+    // The outer side of the band goes out from the center, the inner side comes back, half an arm gap below
+    const double turns = 4;
+    int half = max(size / 2, 32);
+    double gap = 0.8 * RADIUS / turns;
+    vector<Point> vertices(2 * half);
+    for (int i = 0; i < half; i++) {
+      double t = (double)i / (half - 1);
+      double angle = 2 * M_PI * turns * t;
+      double radius = 0.2 * RADIUS + 0.8 * RADIUS * t;
+      vertices[i] = Point(llround(radius * cos(angle)), llround(radius * sin(angle)));
+      vertices[2 * half - 1 - i] = Point(llround((radius - gap / 2) * cos(angle)), llround((radius - gap / 2) * sin(angle)));
+    }
+    polygon = Polygon(vertices);
+  } else {
+    return false;
+  }
+  polygon.checkLastPoint();
+  return true;
+}
+
+bool WorkloadGenerator::makePoints(const string& kind, size_t count, const BoundingBox& box, vector<Point>& points) {
+  double width = box.maxX - box.minX, height = box.maxY - box.minY;
+  double centerX = box.minX + width / 2, centerY = box.minY + height / 2;
+  points.resize(count);
+  if (kind == "uniform") {
+    for (auto& point : points)
+      point = Point(llround(uniform(box.minX - width / 10, box.maxX + width / 10)), llround(uniform(box.minY - height / 10, box.maxY + height / 10)));
+  } else if (kind == "gaussian") {
+    normal_distribution<double> x(centerX, width / 6), y(centerY, height / 6);
+    for (auto& point : points)
+      point = Point(llround(x(random)), llround(y(random)));
+  } else if (kind == "circle") {
+    double radius = min(width, height) / 2;
+    for (auto& point : points) {
+      double angle = uniform(0, 2 * M_PI);
+      point = Point(llround(centerX + radius * cos(angle)), llround(centerY + radius * sin(angle)));
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef ZONE_INDEX_H
+#define ZONE_INDEX_H
+
+#include <vector>
+#include <algorithm>
+#include "geometric_basics.h"
+#include "point_location.h"
+#include "slab_index.h"
+#include "convex_locator.h"
+#include "rtree.h"
+
+using namespace std;
+
+/**
+ * @brief Locates points among many polygons (zones).
+ *
+ * A packed R-tree over the zone bounding boxes gives the few candidate zones of a point,
+ * and only these are tested, each with its own locator: the convex locator for convex zones,
+ * a slab index for the others.
+ */
+class ZoneIndex {
+private:
+  vector<ConvexLocator> convexLocators;
+  vector<SlabIndex> slabIndexes; /**< Only built for the zones that are not convex. */
+  PackedRTree tree;
+public:
+  /**
+   * @param zones The polygons to index; a zone id is its position in this vector.
+   */
+  ZoneIndex(const vector<Polygon>& zones);
+
+  /**
+   * @brief Finds the zones containing a point.
+   * @param point The point to locate.
+   * @param candidates A scratch vector, reused between calls to avoid allocations.
+   * @param zones Receives the id of every zone containing the point with its position, INSIDE or BOUNDARY,
+   * by increasing id, replacing its content.
+   */
+  void getZones(Point point, vector<int>& candidates, vector<pair<int, PointPosition>>& zones) const;
+
+  /**
+   * @brief Tests a point against a single zone, with the locator of that zone.
+   * @param zone The id of the zone.
+   * @param point The point to test.
+   * @return The position of the point with respect to the zone.
+   */
+  PointPosition getPointPosition(int zone, Point point) const;
+
+  size_t getZonesCount() const { return convexLocators.size(); }
+};
+
+ZoneIndex::ZoneIndex(const vector<Polygon>& zones) {
+  GEO_PHASE("prepare");
+  convexLocators.resize(zones.size());
+  slabIndexes.resize(zones.size());
+  vector<BoundingBox> boxes;
+  for (size_t i = 0; i < zones.size(); i++) {
+    if (!convexLocators[i].build(zones[i]))
+      slabIndexes[i].build(zones[i]);
+    boxes.push_back(BoundingBox::of(zones[i]));
+  }
+  tree.build(boxes);
+}
+
+void ZoneIndex::getZones(Point point, vector<int>& candidates, vector<pair<int, PointPosition>>& zones) const {
+  GEO_COUNT(POINTS_CLASSIFIED, 1);
+  zones.clear();
+  tree.query(point, candidates);
+  sort(candidates.begin(), candidates.end());
+  for (int zone : candidates) {
+    PointPosition position = getPointPosition(zone, point);
+    if (position != OUTSIDE)
+      zones.push_back({ zone, position });
+  }
+}
+
+PointPosition ZoneIndex::getPointPosition(int zone, Point point) const {
+  return convexLocators[zone].isConvex() ? convexLocators[zone].getPointPosition(point) : slabIndexes[zone].getPointPosition(point);
+}
+
+#endif
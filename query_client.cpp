@@ -0,0 +1,69 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include "geo_headers/geometric_basics.h"
+#include "geo_headers/command_line.h"
+#include "geo_headers/point_reader.h"
+#include "geo_headers/point_location.h"
+#include "geo_headers/output_buffer.h"
+#include "geo_headers/query_client.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+  CommandLine commandLine(argc, argv);
+  if (commandLine.getPositionalCount() < 3) {
+    cout << "Please pass the socket path, the input and output files name!\n";
+    return 0;
+  }
+
+  // The points come in the convex hull format, as pairs of coordinates
+  MappedFile input(commandLine.getPositional(1));
+  vector<Point> points;
+  if (!input.isOpen() || !PointReader::readPoints(input, points, nullptr)) {
+    cout << "Invalid input file!\n";
+    return 0;
+  }
+  QueryClient client(commandLine.getPositional(0));
+  if (!client.isConnected()) {
+    cout << "Could not connect to " << commandLine.getPositional(0) << "!\n";
+    return 0;
+  }
+  FileWriter output(commandLine.getPositional(2));
+  if (!output.isOpen()) {
+    cout << "Could not create the output file!\n";
+    return 0;
+  }
+
+  size_t batchSize = min<ll>(max(commandLine.getInt("batch", 4096), 1LL), MAX_QUERY_POINTS);
+  uint32_t polygon = commandLine.getInt("polygon", 0);
+  vector<PointPosition> positions;
+  vector<double> latencies;
+  OutputBuffer text;
+  auto start = chrono::steady_clock::now();
+  for (size_t begin = 0; begin < points.size(); begin += batchSize) {
+    size_t count = min(batchSize, points.size() - begin);
+    auto sent = chrono::steady_clock::now();
+    QueryStatus status = client.classify(polygon, points.data() + begin, count, positions);
+    latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - sent).count());
+    if (status == QUERY_UNKNOWN_POLYGON) {
+      cout << "The server has no polygon " << polygon << "!\n";
+      return 0;
+    }
+    if (status != QUERY_OK) {
+      cout << "The connection to the server failed!\n";
+      return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+      text.appendPoint(points[begin + i]);
+      text.append(": ", 2);
+      text.append(getPositionName(positions[i]));
+      text.append('\n');
+    }
+    if (text.getSize() >= FileWriter::FLUSH_SIZE)
+      output.write(text);
+  }
+  output.write(text);
+  printLatencies(latencies, points.size(), chrono::duration<double>(chrono::steady_clock::now() - start).count());
+  return 0;
+}
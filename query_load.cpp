@@ -0,0 +1,66 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include "geo_headers/geometric_basics.h"
+#include "geo_headers/command_line.h"
+#include "geo_headers/point_location.h"
+#include "geo_headers/query_client.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+  CommandLine commandLine(argc, argv);
+  if (commandLine.getPositionalCount() < 1) {
+    cout << "Please pass the socket path!\n";
+    return 0;
+  }
+
+  ll minX = -1000, minY = -1000, maxX = 1000, maxY = 1000;
+  if (commandLine.hasOption("range") &&
+      (sscanf(commandLine.getString("range", "").c_str(), "%lld,%lld,%lld,%lld", &minX, &minY, &maxX, &maxY) != 4 || minX > maxX || minY > maxY)) {
+    cout << "Please pass the points rectangle as --range=minX,minY,maxX,maxY!\n";
+    return 0;
+  }
+  int connectionsCount = max(commandLine.getInt("connections", 4), 1LL);
+  size_t requestsCount = max(commandLine.getInt("requests", 10000), 1LL);
+  size_t batchSize = min<ll>(max(commandLine.getInt("batch", 16), 1LL), MAX_QUERY_POINTS);
+  uint32_t polygon = commandLine.getInt("polygon", 0);
+
+  // Every connection sends its requests one after the other from its own thread, with its own random points
+  vector<vector<double>> threadLatencies(connectionsCount);
+  vector<char> failed(connectionsCount, false);
+  vector<thread> threads;
+  auto start = chrono::steady_clock::now();
+  for (int c = 0; c < connectionsCount; c++)
+    threads.push_back(thread([&, c]() {
+      QueryClient client(commandLine.getPositional(0));
+      mt19937_64 random(commandLine.getInt("seed", 1) + c);
+      uniform_int_distribution<ll> randomX(minX, maxX), randomY(minY, maxY);
+      vector<Point> points(batchSize);
+      vector<PointPosition> positions;
+      for (size_t r = c; r < requestsCount && !failed[c]; r += connectionsCount) {
+        for (auto& point : points)
+          point = Point(randomX(random), randomY(random));
+        auto sent = chrono::steady_clock::now();
+        failed[c] = client.classify(polygon, points.data(), points.size(), positions) != QUERY_OK;
+        threadLatencies[c].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - sent).count());
+      }
+    }));
+  for (auto& thread : threads)
+    thread.join();
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  for (int c = 0; c < connectionsCount; c++)
+    if (failed[c]) {
+      cout << "A request failed, check the server and the polygon index!\n";
+      return 0;
+    }
+  vector<double> latencies;
+  for (auto& connectionLatencies : threadLatencies)
+    latencies.insert(latencies.end(), connectionLatencies.begin(), connectionLatencies.end());
+  printLatencies(latencies, latencies.size() * batchSize, seconds);
+  return 0;
+}
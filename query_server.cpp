@@ -0,0 +1,48 @@
+#include <iostream>
+#include <vector>
+#include "geo_headers/geometric_basics.h"
+#include "geo_headers/command_line.h"
+#include "geo_headers/thread_pool.h"
+#include "geo_headers/point_reader.h"
+#include "geo_headers/zone_index.h"
+#include "geo_headers/query_server.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+  CommandLine commandLine(argc, argv);
+  if (commandLine.getPositionalCount() < 2) {
+    cout << "Please pass the polygons file and the socket path!\n";
+    return 0;
+  }
+
+  // The polygons come in the ray casting format, or in its zones format with --zones; the query points are ignored.
+  // The parsing threads are gone before the server starts, the stop signals being blocked only for the threads created after
+  vector<Polygon> polygons(1);
+  bool valid;
+  {
+    ThreadPool pool(commandLine.getInt("threads", 0));
+    MappedFile input(commandLine.getPositional(0));
+    vector<Point> ignored;
+    valid = input.isOpen();
+    if (valid && commandLine.hasOption("zones"))
+      valid = PointReader::readZonesAndPoints(input, polygons, ignored, &pool);
+    else if (valid)
+      valid = PointReader::readPolygonAndPoints(input, polygons[0], ignored, &pool);
+  }
+  if (!valid) {
+    cout << "Invalid input file!\n";
+    return 0;
+  }
+
+  ZoneIndex zones(polygons);
+  QueryServer server(zones, commandLine.getInt("threads", 0));
+  if (!server.listen(commandLine.getPositional(1))) {
+    cout << "Could not listen on " << commandLine.getPositional(1) << "!\n";
+    return 0;
+  }
+  cout << "Serving " << polygons.size() << " polygons on " << commandLine.getPositional(1) << endl;
+  server.run();
+  cout << "Answered " << server.getRequestsCount() << " requests, " << server.getPointsCount() << " points\n";
+  return 0;
+}
@@ -1,181 +1,403 @@
 #include <iostream>
-#include <fstream>
-#include <map>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include "geo_headers/geometric_basics.h"
+#include "geo_headers/command_line.h"
+#include "geo_headers/thread_pool.h"
+#include "geo_headers/point_reader.h"
+#include "geo_headers/binary_points.h"
+#include "geo_headers/point_location.h"
+#include "geo_headers/locator_factory.h"
+#include "geo_headers/raster_mask.h"
+#include "geo_headers/zone_index.h"
+#include "geo_headers/bounded_queue.h"
+#include "geo_headers/output_buffer.h"
+#include "geo_headers/position_cache.h"
+#ifndef GEO_HEADLESS
 #include "geo_headers/renderer.h"
+#include "geo_headers/density_map.h"
+#endif
 
 typedef long long ll;
 
 using namespace std;
 
-enum LastLineStatus { hitBottom, hitTop, hitInside, hitStraight, none};
-enum PointPosition { INSIDE, OUTSIDE, BOUNDARY };
-class RayCasting {
-private:
-  static LastLineStatus lastLineStatus;
-  static long linesCrossed;
-
-  RayCasting();
-  RayCasting(const RayCasting&);
-
-  static bool checkCrossedLines(Line line1, Line line2);
-  static bool pointInsideLine(Point point, Line line);
-  static void reset() {
-    lastLineStatus = none;
-    linesCrossed = 0;
-  }
-public:
-  /**
-   * @brief Determines the position of a point with respect to a polygon.
-   * @param point The point to be tested.
-   * @param polygon The polygon to be tested against.
-   * @return The position of the point: INSIDE, OUTSIDE, or BOUNDARY.
-   */
-  static PointPosition getPointPosition(Point point, Polygon& polygon);
-};
-
-long RayCasting::linesCrossed = 0;
-LastLineStatus RayCasting::lastLineStatus = none;
-
-bool RayCasting::checkCrossedLines(Line line, Line extremeLine) {
-  ll pos1  = orientationTest(line, extremeLine.getStartPoint()); // The position of the extremeLine start point compared to line
-  ll pos2 = orientationTest(line, extremeLine.getEndPoint()); // The position of the extremeLine end point compared to line
-  ll pos3 = orientationTest(extremeLine, line.getStartPoint()); // The position of the line start point compared to extremeLine
-  ll pos4 = orientationTest(extremeLine, line.getEndPoint()); // The position of the line end point compared to extremeLine
-
-  // If the lines do not cross
-  if (((pos1 > 0 && pos2 > 0) || (pos1 < 0 && pos2 < 0)) || ((pos3 > 0 && pos4 > 0) || (pos3 < 0 && pos4 < 0)))
-    return false;
+#ifndef GEO_HEADLESS
+/**
+ * @brief Shows the polygons and the classified points until the window is closed, redrawing only when needed.
+ * @param density If true, the points are aggregated per pixel into a density map that can be panned and zoomed.
+ */
+template <class T>
+void visualize(const vector<Polygon>& polygons, const BasicPoint<T>* points, const PointPosition* positions, size_t pointsCount, ThreadPool& pool, bool density) {
+  Renderer renderer(800, 800, "Ray Casting");
+  if (!renderer.isOpen()) {
+    cout << "Could not open a window, use --headless on machines without a display!\n";
+    return;
+  }
+  for (auto& polygon : polygons)
+    renderer.fit(polygon);
+  renderer.fit(points, pointsCount);
 
-  // If the lines are collinear, check if they intersect or touch at any point
-  if (pos1 == 0 && pos2 == 0 && pos3 == 0 && pos4 == 0) {
-    if (
-      pointInsideLine(line.getStartPoint(), extremeLine) || 
-      pointInsideLine(line.getEndPoint(), extremeLine) ||
-      pointInsideLine(extremeLine.getStartPoint(), line) ||
-      pointInsideLine(extremeLine.getEndPoint(), line)
-    ) 
-      return true;
-    else 
-      return false;
+  if (density) {
+    // The colors are indexed by PointPosition: green, red and yellow
+    DensityMap densityMap(800, 800, { {31, 145, 0}, {145, 0, 17}, {200, 130, 0} });
+    densityMap.setPoints(points, pointsCount, [&](size_t i) { return positions[i]; }, pool);
+    densityMap.setView(0, 0, 1 / renderer.getScale());
+    ViewChange change;
+    do {
+      densityMap.pan(change.panX, change.panY);
+      if (change.zoom != 1)
+        densityMap.zoom(change.zoom, change.zoomX, change.zoomY);
+      densityMap.update(pool);
+      renderer.setView(densityMap.getCenterX(), densityMap.getCenterY(), 1 / densityMap.getUnitsPerPixel());
+      renderer.drawPixels(densityMap.getPixels());
+      for (auto& polygon : polygons)
+        renderer.drawPolygon(polygon);
+      renderer.update();
+    } while (renderer.waitForRedraw(&change));
+    return;
   }
 
+  // Transform every point once, grouped by color, instead of drawing them one by one every frame
+  PointBatch inside(31, 145, 0); // green
+  PointBatch outside(145, 0, 17); // red
+  PointBatch boundary(200, 130, 0); // yellow
+  for (size_t i = 0; i < pointsCount; i++) {
+    switch (positions[i]){
+      case INSIDE:
+        renderer.addToBatch(inside, Point(points[i]));
+        break;
+      case OUTSIDE:
+        renderer.addToBatch(outside, Point(points[i]));
+        break;
+      case BOUNDARY:
+        renderer.addToBatch(boundary, Point(points[i]));
+        break;
+      default:
+        break;
+    }
+  }
 
-  // Checking if the lines are intersecting only in one point
-  // Both points are left (top)
-  if (pos3 >= 0 && pos4 >= 0) {
+  do {
+    renderer.drawCached([&]() {
+      renderer.clear();
+      renderer.drawAxis();
+      for (auto& polygon : polygons)
+        renderer.drawPolygon(polygon);
+      renderer.drawBatch(inside);
+      renderer.drawBatch(outside);
+      renderer.drawBatch(boundary);
+    });
+    renderer.update();
+  } while (renderer.waitForRedraw());
+}
+#endif
 
-    // And the last line was touched only in one edge, but it was on the bottom
-    if (lastLineStatus == hitBottom)
-      linesCrossed += 1;
+/**
+ * @brief Locates every query point among many polygons, listing the zones that contain it.
+ * @return The exit code.
+ */
+int locateInZones(const CommandLine& commandLine, ThreadPool& pool) {
+  MappedFile input(commandLine.getPositional(0));
+  vector<Polygon> zones;
+  vector<Point> points;
+  if (!input.isOpen() || !PointReader::readZonesAndPoints(input, zones, points, &pool)) {
+    cout << "Invalid input file!\n";
+    return 0;
+  }
+  ZoneIndex zoneIndex(zones);
+  FileWriter output(commandLine.getPositional(1));
+  if (!output.isOpen()) {
+    cout << "Could not create the output file!\n";
+    return 0;
+  }
 
-    lastLineStatus = hitTop;
-    return true;
-  } 
-  // Both points are right (bottom)
-  else if (pos3 <= 0 && pos4 <= 0) {
+  // Every chunk of points is located and formatted on its own thread, then written in input order.
+  // A point is shown INSIDE if a zone contains it, BOUNDARY if it is only on zone borders.
+  const size_t chunkSize = 4096;
+  size_t chunksCount = (points.size() + chunkSize - 1) / chunkSize;
+  vector<OutputBuffer> chunkOutputs(chunksCount);
+  vector<PointPosition> pointPositions(points.size());
+  {
+    GEO_PHASE("classify");
+    pool.parallelFor(chunksCount, 1, [&](size_t first, size_t last) {
+      vector<int> candidates;
+      vector<pair<int, PointPosition>> pointZones;
+      for (size_t chunk = first; chunk < last; chunk++) {
+        OutputBuffer& out = chunkOutputs[chunk];
+        for (size_t i = chunk * chunkSize; i < min(points.size(), (chunk + 1) * chunkSize); i++) {
+          zoneIndex.getZones(points[i], candidates, pointZones);
+          out.appendPoint(points[i]);
+          out.append(':');
+          pointPositions[i] = pointZones.empty() ? OUTSIDE : BOUNDARY;
+          for (size_t j = 0; j < pointZones.size(); j++) {
+            out.append(j == 0 ? " " : ", ");
+            out.appendInteger(pointZones[j].first);
+            out.append(' ');
+            out.append(getPositionName(pointZones[j].second));
+            if (pointZones[j].second == INSIDE)
+              pointPositions[i] = INSIDE;
+          }
+          if (pointZones.empty())
+            out.append(" OUTSIDE");
+          out.append('\n');
+        }
+      }
+    });
+  }
+  for (auto& chunkOutput : chunkOutputs)
+    output.write(chunkOutput);
+
+#ifndef GEO_HEADLESS
+  if (!commandLine.hasOption("headless"))
+    visualize(zones, points.data(), pointPositions.data(), points.size(), pool, commandLine.hasOption("density") || points.size() > DensityMap::POINTS_THRESHOLD);
+#endif
+  return 0;
+}
 
-    // And the last line was touched only in one edge, but it was on the top
-    if (lastLineStatus == hitTop)
-      linesCrossed += 1;
+/**
+ * @brief Classifies every point of a lattice with a scanline over the polygon, instead of the query points.
+ * @return The exit code.
+ */
+int rasterizePolygon(const CommandLine& commandLine, const Polygon& polygon, ThreadPool& pool) {
+  ll minX, minY, maxX, maxY;
+  if (sscanf(commandLine.getString("raster", "").c_str(), "%lld,%lld,%lld,%lld", &minX, &minY, &maxX, &maxY) != 4) {
+    cout << "Please pass the raster rectangle as --raster=minX,minY,maxX,maxY!\n";
+    return 0;
+  }
+  RasterMask mask(minX, minY, maxX, maxY, commandLine.getInt("step", 1));
+  mask.rasterize(polygon, pool);
 
-    lastLineStatus = hitBottom;
-    return true;
+  FileWriter output(commandLine.getPositional(1));
+  if (!output.isOpen()) {
+    cout << "Could not create the output file!\n";
+    return 0;
   }
+  bool written = commandLine.hasOption("packed") ? mask.writePacked(output) : mask.writeRuns(output);
+  if (!written)
+    cout << "Could not write the output file!\n";
+  return 0;
+}
+
+/**
+ * @brief Builds the locator chosen on the command line, then hands a batch classifier over it to a function.
+ * @param body Called once with classify(points, count, positions), which classifies a batch of points of any
+ * coordinate type and may be called for any number of batches.
+ * @return False if the locator is unknown or does not fit the polygon.
+ */
+template <class Body>
+bool withLocator(const CommandLine& commandLine, const Polygon& polygon, ThreadPool& pool, Body body) {
+  // With --cache, the repeated points of every batch are answered from the cache and only the new ones reach the locator
+  bool cached = commandLine.hasOption("cache");
+  PositionCache cache(cached ? max(commandLine.getInt("cache", 1 << 20), 1LL) : 0);
+  auto run = [&](auto classify) {
+    if (!cached) {
+      body(classify);
+      return;
+    }
+    body([&](auto points, size_t count, PointPosition* positions) { cache.classify(points, count, positions, classify, pool); });
+    cout << "Cache: " << cache.getHits() << " hits, " << cache.getMisses() << " misses\n";
+  };
 
-  // The lines are crossed one into another
-  linesCrossed++;
-  lastLineStatus = hitInside;
+  // Convex polygons are answered in O(log N) per point, any other polygon goes to the slab index
+  string locator = commandLine.getString("locator", "auto");
+  if (!withNamedLocator(locator, polygon, pool, commandLine.getInt("grid-cells", 0), nullptr, run)) {
+    if (locator == "convex")
+      cout << "The polygon is not convex!\n";
+    else
+      cout << "Unknown locator " << locator << "!\n";
+    return false;
+  }
   return true;
 }
 
-bool RayCasting::pointInsideLine(Point point, Line line) {
-  // If the points are not collinear then the point is not on the line
-  if (orientationTest(line, point) != 0) return false;
-  // But if they are collinear then we check if the point is on the line
-  ll d1 = point.getX() - line.getStartPoint().getX();
-  ll d2 = line.getEndPoint().getX() - point.getX();
-  return d1*d2 >= 0;
+/**
+ * @brief Appends the output lines of classified points, like "(5, 5): INSIDE".
+ */
+template <class T>
+void appendPositions(OutputBuffer& output, const BasicPoint<T>* points, const PointPosition* positions, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    output.appendPoint(points[i]);
+    output.append(": ", 2);
+    output.append(getPositionName(positions[i]));
+    output.append('\n');
+  }
 }
 
-PointPosition RayCasting::getPointPosition(Point point, Polygon& polygon) {
-  polygon.checkLastPoint();
-  Line extremeLine(point, Point(polygon.getRightExtreme() + 10, point.getY()));
-  reset();
-  Line line;
-  for (ll i = 0; i < polygon.getSize(); i++) {
-    if (i < polygon.getSize() - 1) 
-      line = Line(polygon.getPoint(i), polygon.getPoint(i+1));
-    else
-      line = Line(polygon.getPoint(i), polygon.getPoint(0));
+/**
+ * @brief Classifies the query points against the polygon with the locator chosen on the command line, and writes them.
+ * @param queryPoints The points, with the coordinate type they were loaded with.
+ * @return The exit code.
+ */
+template <class T>
+int locatePoints(const CommandLine& commandLine, const Polygon& polygon, const BasicPoint<T>* queryPoints, size_t pointsCount, ThreadPool& pool) {
+  FileWriter output(commandLine.getPositional(1));
+  if (!output.isOpen()) {
+    cout << "Could not create the output file!\n";
+    return 0;
+  }
 
-    // If it is equal to one of these points, then it is automatically on the edge of the polygon
-    if (point == line.getStartPoint() || point == line.getEndPoint())
-      return BOUNDARY;
+  vector<PointPosition> pointPositions(pointsCount);
+  // With --dedup, every distinct point is classified once and its position copied to the repeats
+  bool located = withLocator(commandLine, polygon, pool, [&](auto classify) {
+    if (!commandLine.hasOption("dedup")) {
+      classify(queryPoints, pointsCount, pointPositions.data());
+      return;
+    }
+    size_t distinct = classifyDistinct(queryPoints, pointsCount, pointPositions.data(), classify, pool);
+    cout << "Classified " << distinct << " distinct of " << pointsCount << " points\n";
+  });
+  if (!located)
+    return 0;
 
-    // If these two lines intersect and the point is inside the line
-    if (checkCrossedLines(line, extremeLine) && pointInsideLine(point, line))
-      return BOUNDARY;
+  // The lines are formatted in parallel, a few chunks per thread at a time, and every round is written at once
+  GEO_PHASE("output");
+  const size_t chunkSize = 1 << 16;
+  size_t chunksCount = (pointsCount + chunkSize - 1) / chunkSize;
+  vector<OutputBuffer> chunkOutputs(pool.getThreadsCount() * 4);
+  for (size_t round = 0; round < chunksCount; round += chunkOutputs.size()) {
+    size_t roundChunks = min(chunkOutputs.size(), chunksCount - round);
+    pool.parallelFor(roundChunks, 1, [&](size_t first, size_t last) {
+      for (size_t chunk = first; chunk < last; chunk++) {
+        size_t begin = (round + chunk) * chunkSize;
+        size_t end = min(pointsCount, begin + chunkSize);
+        appendPositions(chunkOutputs[chunk], queryPoints + begin, pointPositions.data() + begin, end - begin);
+      }
+    });
+    for (size_t chunk = 0; chunk < roundChunks; chunk++)
+      output.write(chunkOutputs[chunk]);
   }
 
-  if (linesCrossed % 2 == 0) return OUTSIDE;
-  else return INSIDE;
+#ifndef GEO_HEADLESS
+  if (!commandLine.hasOption("headless"))
+    visualize(vector<Polygon>(1, polygon), queryPoints, pointPositions.data(), pointsCount, pool, commandLine.hasOption("density") || pointsCount > DensityMap::POINTS_THRESHOLD);
+#endif
+  return 0;
+}
+
+/**
+ * @brief Classifies a text input in a pipeline: a parser thread, the classification on the pool, then a writer thread,
+ * joined by bounded queues, so the stages overlap and the memory used does not depend on the number of points.
+ * @return The exit code.
+ */
+int streamPoints(const CommandLine& commandLine, ThreadPool& pool) {
+  PointStream input(commandLine.getPositional(0));
+  Polygon polygon;
+  ll pointsCount = -1;
+  if (!input.isOpen() || !input.readPolygon(polygon) || !input.readInteger(pointsCount) || pointsCount < 0) {
+    cout << "Invalid input file!\n";
+    return 0;
+  }
+  FileWriter output(commandLine.getPositional(1));
+  if (!output.isOpen()) {
+    cout << "Could not create the output file!\n";
+    return 0;
+  }
+
+  struct Batch {
+    vector<Point> points;
+    vector<PointPosition> positions;
+  };
+  const size_t batchSize = 1 << 16;
+  const size_t queueCapacity = 8;
+  BoundedQueue<Batch> parsed(queueCapacity), classified(queueCapacity);
+
+  bool parseFailed = false;
+  thread parser([&]() {
+    ll left = pointsCount;
+    Batch batch;
+    while (left > 0 && input.readChunk(batch.points, min<ll>(left, batchSize))) {
+      if ((ll)batch.points.size() > left)
+        batch.points.resize(left);
+      left -= batch.points.size();
+      parsed.push(move(batch));
+      batch = Batch();
+    }
+    parseFailed = left > 0;
+    parsed.close();
+  });
+
+  bool writeFailed = false;
+  thread writer([&]() {
+    OutputBuffer text;
+    Batch batch;
+    while (classified.pop(batch)) {
+      appendPositions(text, batch.points.data(), batch.positions.data(), batch.points.size());
+      if (text.getSize() >= FileWriter::FLUSH_SIZE)
+        writeFailed |= !output.write(text);
+    }
+    writeFailed |= !output.write(text);
+  });
+
+  Batch batch;
+  bool located = withLocator(commandLine, polygon, pool, [&](auto classify) {
+    while (parsed.pop(batch)) {
+      batch.positions.resize(batch.points.size());
+      classify(batch.points.data(), batch.points.size(), batch.positions.data());
+      classified.push(move(batch));
+    }
+  });
+  // Without a locator the parser is drained, so that it does not wait on a full queue forever
+  if (!located)
+    while (parsed.pop(batch));
+  classified.close();
+  parser.join();
+  writer.join();
+
+  if (located && parseFailed)
+    cout << "Invalid input file!\n";
+  else if (writeFailed)
+    cout << "Could not write the output file!\n";
+  return 0;
 }
 
 int main(int argc, char* argv[]) {
-  if (argc < 3) {
+  CommandLine commandLine(argc, argv);
+  setInstrumentationReport(commandLine.getString("instrument-json", ""));
+  if (commandLine.getPositionalCount() < 2) {
     cout << "Please pass the input and output files name!\n";
     return 0;
   }
 
-  ifstream fin(argv[1]);
-  ofstream fout(argv[2]);
+  // Parse and classify on every core unless --threads says otherwise
+  ThreadPool pool(commandLine.getInt("threads", 0));
+  if (commandLine.hasOption("zones"))
+    return locateInZones(commandLine, pool);
+  if (commandLine.hasOption("stream"))
+    return streamPoints(commandLine, pool);
 
-  map<Point, PointPosition> pointPositions;
-  
+  // Binary files are used in place, whatever their coordinate size; text files keep the narrowest coordinate type
+  MappedFile input(commandLine.getPositional(0));
   Polygon polygon;
-  fin >> polygon;
-  
-  int pointsCount;
-  fin >> pointsCount;
-
-  Point p;
-  for (int i = 0; i < pointsCount; i++) {
-    fin >> p;
-    pointPositions[p] = RayCasting::getPointPosition(p, polygon);
-    fout << p << ": " << ((pointPositions[p] == INSIDE) ? "INSIDE" : ((pointPositions[p] == OUTSIDE) ? "OUTSIDE" : "BOUNDARY") ) << endl;
+  if (input.isOpen() && BinaryPointsFile::isBinary(input)) {
+    BinaryPointsFile binaryInput(input);
+    if (!binaryInput.isValid()) {
+      cout << "Invalid input file!\n";
+      return 0;
+    }
+    binaryInput.readPolygon(polygon);
+    if (commandLine.hasOption("raster"))
+      return rasterizePolygon(commandLine, polygon, pool);
+    if (binaryInput.getMappedPoints<int32_t>() != nullptr)
+      return locatePoints(commandLine, polygon, binaryInput.getMappedPoints<int32_t>(), binaryInput.getPointsCount(), pool);
+    return locatePoints(commandLine, polygon, binaryInput.getMappedPoints<ll>(), binaryInput.getPointsCount(), pool);
   }
 
-  Renderer renderer(800, 800, "Ray Casting");
-  bool running = true;
-  while (running) { 
-    if (renderer.shouldQuit())
-      running = false;
-    
-    renderer.clear();
-    renderer.drawAxis();
-    renderer.drawPolygon(polygon);
-
-    // Render all points
-    map<Point, PointPosition>::iterator it;
-    for (it = pointPositions.begin(); it != pointPositions.end(); ++it) {
-      Point point = it->first;
-      switch (it->second){
-        case INSIDE:
-          renderer.drawPoint(point, 31, 145, 0); // green
-          break;
-        case OUTSIDE:
-          renderer.drawPoint(point, 145, 0, 17); // red
-          break;
-        case BOUNDARY:
-          renderer.drawPoint(point, 200, 130, 0); // yellow
-          break;
-        default:
-          break;
-      }
+  // A raster only needs the polygon, the query points after it are not even parsed
+  if (commandLine.hasOption("raster")) {
+    PointStream polygonInput(commandLine.getPositional(0));
+    if (!polygonInput.isOpen() || !polygonInput.readPolygon(polygon)) {
+      cout << "Invalid input file!\n";
+      return 0;
     }
-    renderer.update();
+    return rasterizePolygon(commandLine, polygon, pool);
   }
-  fin.close();
-  fout.close();
-  return 0;
-}
\ No newline at end of file
+
+  PointArray points;
+  if (!input.isOpen() || !PointReader::readPolygonAndPoints(input, polygon, points, &pool)) {
+    cout << "Invalid input file!\n";
+    return 0;
+  }
+  return points.visit([&](auto& queryPoints) { return locatePoints(commandLine, polygon, queryPoints.data(), queryPoints.size(), pool); });
+}